@@ -0,0 +1,25 @@
+#ifndef POINT_CLOUD_PROC_CLUSTER_STATS_H
+#define POINT_CLOUD_PROC_CLUSTER_STATS_H
+
+#include <vector>
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <Eigen/Core>
+
+// Point count, centroid, axis aligned bounds and covariance of a set of points
+struct ClusterStats {
+    int count;
+    Eigen::Vector3f centroid;
+    Eigen::Vector3f min, max;
+    Eigen::Matrix3f covariance;
+};
+
+// Single pass over the points given by indices, non finite points are skipped
+bool computeClusterStats(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, const std::vector<int> &indices,
+                         ClusterStats &stats);
+
+// Single pass over the whole cloud
+bool computeClusterStats(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, ClusterStats &stats);
+
+#endif //POINT_CLOUD_PROC_CLUSTER_STATS_H
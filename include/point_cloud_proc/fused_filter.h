@@ -0,0 +1,46 @@
+#ifndef POINT_CLOUD_PROC_FUSED_FILTER_H
+#define POINT_CLOUD_PROC_FUSED_FILTER_H
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+// Crop box + NaN removal + voxel grid downsampling in a single pass over the
+// input cloud. Produces the same points, in the same order, as running
+// pcl::PassThrough on x, y, z followed by pcl::VoxelGrid.
+class FusedCropVoxelFilter {
+    typedef pcl::PointXYZRGB PointT;
+    typedef pcl::PointCloud<PointT> CloudT;
+
+public:
+    FusedCropVoxelFilter();
+
+    // limits : [x_min, x_max, y_min, y_max, z_min, z_max]
+    void setLimits(const std::vector<float> &limits);
+
+    void setLeafSize(float leaf_size);
+
+    void filter(const CloudT &cloud_in, CloudT &cloud_out);
+
+private:
+    struct Voxel {
+        int i, j, k;
+        int count;
+        float x, y, z;
+        float r, g, b;
+    };
+
+    static bool voxelLess(const Voxel &v1, const Voxel &v2);
+
+    float min_pt_[4], max_pt_[4];
+    float inverse_leaf_size_;
+
+    // Grid and voxel storage are kept between frames to avoid reallocations
+    std::unordered_map<uint64_t, int> grid_;
+    std::vector<Voxel> voxels_;
+};
+
+#endif //POINT_CLOUD_PROC_FUSED_FILTER_H
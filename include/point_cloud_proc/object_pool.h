@@ -0,0 +1,121 @@
+#ifndef POINT_CLOUD_PROC_OBJECT_POOL_H
+#define POINT_CLOUD_PROC_OBJECT_POOL_H
+
+#include <stddef.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Hands out one object per caller and keeps it for the next caller once it is
+// given back, so concurrent callers never share one and the memory held by the
+// objects, e.g. point and index buffers, is reused instead of allocated again.
+// Objects may outlive the pool, they are destroyed then.
+template<typename T>
+class ObjectPool {
+    struct State {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<T> > idle;
+        size_t max_idle;
+        std::function<void(T &)> reset;
+    };
+
+public:
+    // Called on every object given back, e.g. to clear it while keeping its capacity
+    typedef std::function<void(T &)> Reset;
+
+    class Handle {
+    public:
+        Handle() {}
+
+        Handle(const std::shared_ptr<State> &state, std::unique_ptr<T> object) :
+                state_(state), object_(std::move(object)) {}
+
+        Handle(Handle &&other) : state_(std::move(other.state_)), object_(std::move(other.object_)) {}
+
+        Handle &operator=(Handle &&other) {
+            release();
+            state_ = std::move(other.state_);
+            object_ = std::move(other.object_);
+            return *this;
+        }
+
+        ~Handle() { release(); }
+
+        T &operator*() const { return *object_; }
+
+        T *operator->() const { return object_.get(); }
+
+        // Gives the object back before the handle goes out of scope
+        void release() {
+            if (object_)
+                ObjectPool::recycle(state_, std::move(object_));
+        }
+
+    private:
+        std::shared_ptr<State> state_;
+        std::unique_ptr<T> object_;
+    };
+
+    // At most max_idle objects are kept, the others are destroyed
+    explicit ObjectPool(size_t max_idle = 8, const Reset &reset = Reset()) : state_(new State) {
+        state_->max_idle = max_idle;
+        state_->reset = reset;
+    }
+
+    Handle acquire() {
+        return Handle(state_, take());
+    }
+
+    // Shared pointer of the given type, std:: or boost::shared_ptr<T>, which gives
+    // the object back when its last copy is gone
+    template<typename SharedPtr>
+    SharedPtr acquireShared() {
+        return SharedPtr(take().release(), Recycler(state_));
+    }
+
+    size_t idleCount() {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        return state_->idle.size();
+    }
+
+private:
+    struct Recycler {
+        explicit Recycler(const std::shared_ptr<State> &state) : state(state) {}
+
+        void operator()(T *object) {
+            std::unique_ptr<T> owned(object);
+            std::shared_ptr<State> alive = state.lock();
+            if (alive)
+                ObjectPool::recycle(alive, std::move(owned));
+        }
+
+        std::weak_ptr<State> state;
+    };
+
+    std::unique_ptr<T> take() {
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            if (!state_->idle.empty()) {
+                std::unique_ptr<T> object = std::move(state_->idle.back());
+                state_->idle.pop_back();
+                return object;
+            }
+        }
+        return std::unique_ptr<T>(new T);
+    }
+
+    static void recycle(const std::shared_ptr<State> &state, std::unique_ptr<T> object) {
+        if (state->reset)
+            state->reset(*object);
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->idle.size() < state->max_idle)
+            state->idle.push_back(std::move(object));
+    }
+
+    std::shared_ptr<State> state_;
+};
+
+#endif //POINT_CLOUD_PROC_OBJECT_POOL_H
@@ -0,0 +1,31 @@
+#ifndef POINT_CLOUD_PROC_ORIENTED_BOX_H
+#define POINT_CLOUD_PROC_ORIENTED_BOX_H
+
+#include <vector>
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <point_cloud_proc/cluster_stats.h>
+
+// Box of an object resting on a plane. The z axis is the plane normal pointing
+// towards the object, x is the major axis of the points projected on the plane.
+struct OrientedBox {
+    Eigen::Vector3f center;
+    Eigen::Quaternionf orientation;
+    // Extents along the x, y and z axes of the box
+    Eigen::Vector3f dimensions;
+    // Extreme points along the major axis
+    Eigen::Vector3f major_min, major_max;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+// Linear time estimation from a 2D PCA of the points projected on the plane,
+// plane holds the coefficients [a, b, c, d] of ax + by + cz + d = 0 and stats
+// the centroid and covariance of the same points
+bool estimateOrientedBox(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, const std::vector<int> &indices,
+                         const Eigen::Vector4f &plane, const ClusterStats &stats, OrientedBox &box);
+
+#endif //POINT_CLOUD_PROC_ORIENTED_BOX_H
@@ -0,0 +1,70 @@
+#ifndef POINT_CLOUD_PROC_PLANE_RANSAC_H
+#define POINT_CLOUD_PROC_PLANE_RANSAC_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/PointIndices.h>
+#include <pcl/ModelCoefficients.h>
+#include <Eigen/Core>
+
+#include <point_cloud_proc/soa_cloud.h>
+
+// Plane fitting with RANSAC or MSAC scoring where hypotheses are evaluated in
+// parallel batches. The number of iterations adapts to the best inlier ratio
+// found so far and stops once the requested confidence is reached.
+class ParallelPlaneRansac {
+    typedef pcl::PointXYZRGB PointT;
+    typedef pcl::PointCloud<PointT> CloudT;
+
+public:
+    enum Method {
+        RANSAC,
+        MSAC
+    };
+
+    ParallelPlaneRansac();
+
+    void setMethod(Method method) { method_ = method; }
+
+    void setDistanceThreshold(float threshold) { threshold_ = threshold; }
+
+    void setMaxIterations(int max_iterations) { max_iterations_ = max_iterations; }
+
+    void setProbability(double probability) { probability_ = probability; }
+
+    // Only accept planes whose normal is within eps_angle (radians) of axis,
+    // a zero axis removes the constraint
+    void setAxis(const Eigen::Vector3f &axis, float eps_angle);
+
+    // Only fit planes whose points are given by indices, empty means the whole cloud
+    bool segment(const CloudT &cloud, const std::vector<int> &indices,
+                 pcl::PointIndices &inliers, pcl::ModelCoefficients &coefficients);
+
+    int getIterations() const { return iterations_; }
+
+private:
+    bool computeModel(int sample[3], Eigen::Vector4f &model) const;
+
+    double scoreModel(const Eigen::Vector4f &model, int &inlier_count) const;
+
+    int selectInliers(const Eigen::Vector4f &model, std::vector<int> &inliers) const;
+
+    bool refineModel(const std::vector<int> &inliers, Eigen::Vector4f &model) const;
+
+    Method method_;
+    Eigen::Vector3f axis_;
+    float threshold_, cos_eps_angle_;
+    int max_iterations_, iterations_;
+    double probability_;
+
+    // Number of segment() calls, seeds the samples of the next call
+    uint64_t calls_;
+
+    // Coordinate arrays of the finite input points, scoring tests four points at a time
+    SoACloud points_;
+};
+
+#endif //POINT_CLOUD_PROC_PLANE_RANSAC_H
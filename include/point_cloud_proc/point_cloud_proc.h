@@ -18,54 +18,24 @@
 #include <point_cloud_proc/Mesh.h>
 #include <point_cloud_proc/Plane.h>
 #include <point_cloud_proc/Object.h>
+#include <point_cloud_proc/Objects.h>
+#include <point_cloud_proc/Planes.h>
+#include <point_cloud_proc/PipelineMetrics.h>
 #include <point_cloud_proc/SinglePlaneSegmentation.h>
 #include <point_cloud_proc/MultiPlaneSegmentation.h>
 #include <point_cloud_proc/TabletopExtraction.h>
 #include <point_cloud_proc/TabletopClustering.h>
+#include <point_cloud_proc/point_cloud_proc_core.h>
 
 // PCL
 #include <pcl_ros/point_cloud.h>
 #include <pcl_ros/transforms.h>
-#include <pcl_conversions/pcl_conversions.h>
-#include <pcl/point_types.h>
-#include <pcl/io/pcd_io.h>
-#include <pcl/common/common.h>
-#include <pcl/common/pca.h>
-#include <pcl/kdtree/kdtree.h>
-#include <pcl/kdtree/kdtree_flann.h>
-#include <pcl/filters/passthrough.h>
-#include <pcl/filters/voxel_grid.h>
-#include <pcl/filters/extract_indices.h>
-#include <pcl/filters/project_inliers.h>
-#include <pcl/filters/radius_outlier_removal.h>
-#include <pcl/surface/convex_hull.h>
-#include <pcl/sample_consensus/method_types.h>
-#include <pcl/sample_consensus/model_types.h>
-#include <pcl/segmentation/planar_region.h>
-#include <pcl/segmentation/sac_segmentation.h>
-#include <pcl/segmentation/extract_clusters.h>
-#include <pcl/segmentation/extract_polygonal_prism_data.h>
-#include <pcl/segmentation/organized_multi_plane_segmentation.h>
-#include <pcl/segmentation/organized_connected_component_segmentation.h>
-#include <pcl/features/integral_image_normal.h>
-#include <pcl/features/normal_3d.h>
-#include <pcl/features/normal_3d_omp.h>
-#include <pcl/features/moment_of_inertia_estimation.h>
-#include <pcl/surface/gp3.h>
-#include <pcl/surface/poisson.h>
-//#include <pcl/surface/vtk_smoothing/vtk_mesh_quadric_decimation.h>
-
-#include <pcl/surface/mls.h>
-#include <pcl/io/vtk_io.h>
-#include <pcl/io/pcd_io.h>
 
 // Other
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/thread/thread.hpp>
-#include <Eigen/Dense>
-#include <Eigen/Geometry>
-#include <yaml-cpp/yaml.h>
 
 enum AXIS {
     XAXIS,
@@ -73,95 +43,87 @@ enum AXIS {
     ZAXIS
 };
 
-class PointCloudProc {
-    typedef pcl::PointXYZRGB PointT;
-    typedef pcl::Normal PointNT;
-    typedef pcl::PointCloud<PointT> CloudT;
-    typedef pcl::PointCloud<PointNT> CloudNT;
-
+// ROS front end of PointCloudProcCore, frames come from the point cloud
+// topic and are transformed to the fixed frame with TF on demand
+class PointCloudProc : public PointCloudProcCore {
 
 public:
     PointCloudProc(ros::NodeHandle n, bool debug = false, std::string config = "");
 
-    void pointCloudCb(const sensor_msgs::PointCloud2ConstPtr &msg);
-
-    bool transformPointCloud();
-
-    bool filterPointCloud();
-
-    bool removeOutliers(CloudT::Ptr in, CloudT::Ptr out);
+    ~PointCloudProc();
 
-    bool segmentSinglePlane(point_cloud_proc::Plane &plane, char axis = 'z');
+    void pointCloudCb(const sensor_msgs::PointCloud2ConstPtr &msg);
 
-    bool segmentMultiplePlane(std::vector<point_cloud_proc::Plane> &planes);
+    // Transform clouds with this fixed-frame pose of the sensor instead of
+    // looking it up in TF, e.g. for recorded clouds
+    void setFixedTransform(const tf::Transform &transform);
 
-    bool extractTabletop();
+    // Process every incoming frame and publish the table plane on "planes" and
+    // the objects on "objects". The plane of frame N+1 is segmented while the
+    // objects of frame N are computed, frames are dropped when a stage is busy.
+    // The other queries shouldn't be used while streaming.
+    bool startStreaming();
 
-    bool clusterObjects(std::vector<point_cloud_proc::Object> &objects,
-            bool compute_normals = false,
-            bool project = false);
+    void stopStreaming();
 
-    bool projectPointCloudToPlane(sensor_msgs::PointCloud2 &cloud_in,
-                                  sensor_msgs::PointCloud2 &cloud_out,
-                                  pcl::ModelCoefficientsPtr plane_coeffs);
+protected:
+    // Waits for the first cloud and gives the latest one to the core
+    bool acquireInputCloud();
 
-    bool get3DPoint(int col, int row, geometry_msgs::PointStamped &point);
+    void publishPlaneCloud(const CloudT &cloud);
 
-    bool getObjectFromBBox(int *bbox, point_cloud_proc::Object &object);
+    void publishTabletopCloud(const CloudT &cloud);
 
-    bool getObjectFromContour(const std::vector<int> &contour_x,
-            const std::vector<int> &contour_y,
-            point_cloud_proc::Object &object);
+    void publishObjectCloud(const CloudT &cloud);
 
-    bool generatePoissonMesh(sensor_msgs::PointCloud2 &ros_cloud, pcl::PolygonMesh &pcl_mesh);
+    void publishObjectPoses(const geometry_msgs::PoseArray &poses);
 
-    //bool generateMeshFromPointCloud(sensor_msgs::PointCloud2 &cloud, pcl_msgs::PolygonMesh &mesh);
-    bool generateMeshFromPointCloud(sensor_msgs::PointCloud2 &cloud, pcl_msgs::PolygonMesh &mesh, pcl::PolygonMesh &pcl_mesh);
+private:
+    // Handed from the plane to the object stage of the streaming pipeline
+    struct StreamFrame {
+        point_cloud_proc::Plane plane;
+        CloudT::Ptr tabletop;
+        pcl::search::KdTree<PointT>::Ptr tree;
+    };
 
-    bool trianglePointCloud_greedy(sensor_msgs::PointCloud2 &cloud, pcl_msgs::PolygonMesh &mesh, pcl::PolygonMesh &pcl_mesh);
-    bool trianglePointCloud(sensor_msgs::PointCloud2 &cloud, pcl_msgs::PolygonMesh &mesh, pcl::PolygonMesh &pcl_mesh);
+    static std::string getConfigPath(const std::string &config);
 
-    void getRemainingCloud(sensor_msgs::PointCloud2 &cloud);
+    sensor_msgs::PointCloud2ConstPtr getLatestCloud();
 
-    void getFilteredCloud(sensor_msgs::PointCloud2 &cloud);
+    void publishMetrics(const ros::TimerEvent &event);
 
-    sensor_msgs::PointCloud2::Ptr getTabletopCloud();
+    void streamPlaneLoop();
 
-    CloudT::Ptr getFilteredCloud();
+    void streamObjectLoop();
 
-    pcl::PointIndices::Ptr getTabletopIndicies();
+    float tf_timeout_;
+    std::string point_cloud_topic_;
+    sensor_msgs::PointCloud2ConstPtr cloud_raw_ros_;
 
-
-private:
-    pcl::PassThrough<PointT> pass_;
-    pcl::VoxelGrid<PointT> vg_;
-    pcl::SACSegmentation<PointT> seg_;
-    pcl::ExtractIndices<PointT> extract_;
-    pcl::ConvexHull<PointT> chull_;
-    pcl::ExtractPolygonalPrismData<PointT> prism_;
-    pcl::EuclideanClusterExtraction<PointT> ec_;
-    pcl::RadiusOutlierRemoval<PointT> outrem_;
-    pcl::ProjectInliers<PointT> plane_proj_;
-    pcl::GreedyProjectionTriangulation<pcl::PointNormal> gp3_;
-
-    bool debug_;
-    bool pc_received_ = false;
-    int k_search_, min_plane_size_, max_iter_, min_cluster_size_, max_cluster_size_, min_neighbors_;
-    float cluster_tol_, leaf_size_, eps_angle_, single_dist_thresh_, multi_dist_thresh_, radius_search_;
-
-    std::vector<float> pass_limits_, prism_limits_;
-    std::string point_cloud_topic_, fixed_frame_;
-
-    CloudT::Ptr cloud_transformed_, cloud_filtered_, cloud_hull_, cloud_tabletop_;
-    pcl::PointIndices::Ptr tabletop_indicies_;
-    sensor_msgs::PointCloud2 cloud_raw_ros_;
+    // Message of the frame currently held by the core, stamps aren't unique
+    sensor_msgs::PointCloud2ConstPtr transformed_msg_;
+    bool transformed_valid_ = false;
+    tf::StampedTransform cloud_transform_;
+    tf::Transform fixed_transform_;
+    bool has_fixed_transform_ = false;
 
     boost::mutex pc_mutex_;
 
+    // Streaming pipeline, cloud_cond_ is signaled with pc_mutex_ for new frames
+    bool streaming_, has_stream_frame_, stream_compute_normals_;
+    uint8_t stream_payload_;
+    StreamFrame stream_frame_;
+    boost::mutex stream_mutex_;
+    boost::condition_variable cloud_cond_, stream_cond_;
+    boost::thread stream_plane_thread_, stream_object_thread_;
+
     ros::NodeHandle nh_;
+    boost::scoped_ptr<tf::TransformListener> tf_listener_;
     ros::Subscriber point_cloud_sub_;
     ros::Publisher plane_cloud_pub_, tabletop_pub_, debug_cloud_pub_;
     ros::Publisher object_poses_pub_;
+    ros::Publisher planes_pub_, objects_pub_, metrics_pub_;
+    ros::Timer metrics_timer_;
 
 };
 
@@ -0,0 +1,380 @@
+#ifndef POINT_CLOUD_PROC_CORE_H
+#define POINT_CLOUD_PROC_CORE_H
+
+// Messages, only used as plain result structs here
+#include <sensor_msgs/PointCloud2.h>
+#include <geometry_msgs/Point32.h>
+#include <geometry_msgs/PointStamped.h>
+#include <geometry_msgs/PoseArray.h>
+#include <pcl_msgs/PolygonMesh.h>
+#include <point_cloud_proc/Mesh.h>
+#include <point_cloud_proc/Plane.h>
+#include <point_cloud_proc/Object.h>
+#include <point_cloud_proc/fused_filter.h>
+#include <point_cloud_proc/plane_ransac.h>
+#include <point_cloud_proc/prism_extractor.h>
+#include <point_cloud_proc/voxel_clustering.h>
+#include <point_cloud_proc/oriented_box.h>
+#include <point_cloud_proc/cluster_stats.h>
+#include <point_cloud_proc/stage_metrics.h>
+#include <point_cloud_proc/object_pool.h>
+
+// PCL
+#include <pcl_conversions/pcl_conversions.h>
+#include <pcl/point_types.h>
+#include <pcl/io/pcd_io.h>
+#include <pcl/common/common.h>
+#include <pcl/common/io.h>
+#include <pcl/common/pca.h>
+#include <pcl/common/transforms.h>
+#include <pcl/kdtree/kdtree.h>
+#include <pcl/kdtree/kdtree_flann.h>
+#include <pcl/filters/passthrough.h>
+#include <pcl/filters/voxel_grid.h>
+#include <pcl/filters/extract_indices.h>
+#include <pcl/filters/project_inliers.h>
+#include <pcl/filters/radius_outlier_removal.h>
+#include <pcl/surface/convex_hull.h>
+#include <pcl/sample_consensus/method_types.h>
+#include <pcl/sample_consensus/model_types.h>
+#include <pcl/segmentation/planar_region.h>
+#include <pcl/segmentation/sac_segmentation.h>
+#include <pcl/segmentation/extract_clusters.h>
+#include <pcl/segmentation/organized_multi_plane_segmentation.h>
+#include <pcl/segmentation/organized_connected_component_segmentation.h>
+#include <pcl/features/integral_image_normal.h>
+#include <pcl/features/normal_3d.h>
+#include <pcl/features/normal_3d_omp.h>
+#include <pcl/features/moment_of_inertia_estimation.h>
+#include <pcl/surface/gp3.h>
+#include <pcl/surface/poisson.h>
+//#include <pcl/surface/vtk_smoothing/vtk_mesh_quadric_decimation.h>
+
+#include <pcl/surface/mls.h>
+#include <pcl/io/vtk_io.h>
+
+// Other
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <boost/function.hpp>
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <yaml-cpp/yaml.h>
+
+// The processing chain without any ROS communication. Frames are given with
+// setInputCloud() and all the queries run on the last one, which makes it
+// usable in-process or on recorded data. PointCloudProc feeds it from a
+// point cloud topic and TF.
+//
+// All the queries can be called concurrently. Each one works on its own frame
+// snapshot with PCL objects taken from a pool, only the computation of a
+// shared stage of the same frame is serialized.
+class PointCloudProcCore {
+public:
+    typedef pcl::PointXYZRGB PointT;
+    typedef pcl::Normal PointNT;
+    typedef pcl::PointCloud<PointT> CloudT;
+    typedef pcl::PointCloud<PointNT> CloudNT;
+
+    typedef boost::function<void(const point_cloud_proc::Plane &)> PlaneCallback;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    PointCloudProcCore(const std::string &config, bool debug = false);
+
+    virtual ~PointCloudProcCore();
+
+    // New frame given in the sensor frame with the sensor pose in the fixed frame,
+    // organized clouds keep their layout. The cloud is kept, not copied, and only
+    // transformed once a query needs the whole frame
+    void setInputCloud(const CloudT::Ptr &cloud, const Eigen::Matrix4f &sensor_to_fixed);
+
+    // New frame already expressed in the fixed frame
+    void setInputCloud(const CloudT::Ptr &cloud);
+
+    void clearInputCloud();
+
+    StageMetrics &getMetrics() { return metrics_; }
+
+    // Acquires the current frame and transforms all of it to the fixed frame
+    bool transformPointCloud();
+
+    // Queries issued between beginFrame() and endFrame() from the same thread
+    // all run on the frame that was current at beginFrame(), newer frames are
+    // only picked up after endFrame(). Every stage is computed on first use and
+    // shared by the following queries, e.g. the plane, tabletop and bounding
+    // boxes of a pick.
+    bool beginFrame();
+
+    void endFrame();
+
+    bool filterPointCloud();
+
+    bool removeOutliers(CloudT::Ptr in, CloudT::Ptr out);
+
+    // payload selects how the plane points are returned, see Plane.msg. With
+    // PAYLOAD_INDICES they refer to the cloud given by getPlaneFrameCloud()
+    bool segmentSinglePlane(point_cloud_proc::Plane &plane, char axis = 'z',
+                            uint8_t payload = point_cloud_proc::Plane::PAYLOAD_FULL);
+
+    // Forget the plane kept by plane_tracking, e.g. after the robot moved
+    void resetPlaneTracking();
+
+    // plane_cb is called for every plane as soon as it is segmented
+    bool segmentMultiplePlane(std::vector<point_cloud_proc::Plane> &planes,
+                              const PlaneCallback &plane_cb = PlaneCallback(),
+                              uint8_t payload = point_cloud_proc::Plane::PAYLOAD_FULL);
+
+    bool extractTabletop();
+
+    // Object poses are oriented boxes aligned with the table plane, project is
+    // kept for compatibility since points are always projected on the table.
+    // With PAYLOAD_INDICES object points refer to getTabletopCloud(), with
+    // PAYLOAD_NONE no normals are computed either
+    bool clusterObjects(std::vector<point_cloud_proc::Object> &objects,
+            bool compute_normals = false,
+            bool project = false,
+            uint8_t payload = point_cloud_proc::Object::PAYLOAD_FULL);
+
+    bool projectPointCloudToPlane(sensor_msgs::PointCloud2 &cloud_in,
+                                  sensor_msgs::PointCloud2 &cloud_out,
+                                  pcl::ModelCoefficientsPtr plane_coeffs);
+
+    // Pixel and ROI queries only read and transform the requested pixels of the
+    // organized frame, the rest of it is left untouched
+    bool get3DPoint(int col, int row, geometry_msgs::PointStamped &point);
+
+    bool getObjectFromBBox(int *bbox, point_cloud_proc::Object &object);
+
+    bool getObjectFromContour(const std::vector<int> &contour_x,
+            const std::vector<int> &contour_y,
+            point_cloud_proc::Object &object);
+
+    bool generatePoissonMesh(sensor_msgs::PointCloud2 &ros_cloud, pcl::PolygonMesh &pcl_mesh);
+
+    //bool generateMeshFromPointCloud(sensor_msgs::PointCloud2 &cloud, pcl_msgs::PolygonMesh &mesh);
+    bool generateMeshFromPointCloud(sensor_msgs::PointCloud2 &cloud, pcl_msgs::PolygonMesh &mesh, pcl::PolygonMesh &pcl_mesh);
+
+    bool trianglePointCloud_greedy(sensor_msgs::PointCloud2 &cloud, pcl_msgs::PolygonMesh &mesh, pcl::PolygonMesh &pcl_mesh);
+    bool trianglePointCloud(sensor_msgs::PointCloud2 &cloud, pcl_msgs::PolygonMesh &mesh, pcl::PolygonMesh &pcl_mesh);
+
+    // The getters below return the results of the frame held by the beginFrame()
+    // session of this thread. Without a session they read the current frame,
+    // which another thread may replace at any time, so concurrent callers need
+    // a session to get the results of the frame their own queries ran on.
+
+    // Filtered points left after segmentMultiplePlane() removed the planes
+    void getRemainingCloud(sensor_msgs::PointCloud2 &cloud);
+
+    void getFilteredCloud(sensor_msgs::PointCloud2 &cloud);
+
+    sensor_msgs::PointCloud2::Ptr getTabletopCloud();
+
+    void getPlaneFrameCloud(sensor_msgs::PointCloud2 &cloud);
+
+    CloudT::Ptr getFilteredCloud();
+
+    pcl::PointIndices::Ptr getTabletopIndicies();
+
+
+protected:
+    // Makes the latest frame the current one, PointCloudProc fetches it from the
+    // topic and TF. Here it only checks that a frame was given. Never called by
+    // two threads at once
+    virtual bool acquireInputCloud();
+
+    // Intermediate results of debug mode, nothing is done with them here
+    virtual void publishPlaneCloud(const CloudT &cloud) {}
+
+    virtual void publishTabletopCloud(const CloudT &cloud) {}
+
+    virtual void publishObjectCloud(const CloudT &cloud) {}
+
+    virtual void publishObjectPoses(const geometry_msgs::PoseArray &poses) {}
+
+    // Tabletop of the frame of this thread, both stay valid when new frames come in
+    bool getTabletop(CloudT::Ptr &cloud, pcl::search::KdTree<PointT>::Ptr &tree);
+
+    void extractClusters(const CloudT::Ptr &cloud, const pcl::search::KdTree<PointT>::Ptr &tree,
+                         std::vector<pcl::PointIndices> &clusters);
+
+    void getObjectsFromClusters(const CloudT::Ptr &cloud, const pcl::search::KdTree<PointT>::Ptr &tree,
+                                const std::vector<pcl::PointIndices> &clusters,
+                                const Eigen::Vector4f &plane_coef, bool compute_normals,
+                                uint8_t payload, std::vector<point_cloud_proc::Object> &objects);
+
+    // Clouds and index buffers of the frames and queries come from pools, they
+    // are handed back once the last pointer is gone so their capacity is reused.
+    // Frame clouds keep their whole capacity in a few buffers, the others only
+    // keep object sized buffers.
+    CloudT::Ptr allocateFrameCloud();
+
+    CloudT::Ptr allocateCloud();
+
+    bool debug_;
+    std::string fixed_frame_;
+
+    // Loaded config, adapters read their own parameters from it
+    YAML::Node parameters_;
+
+    StageMetrics metrics_;
+
+private:
+    // Input and stage results of one frame. Results are computed on first use
+    // while holding mutex and never modified afterwards, a stage computed again
+    // gets new objects so the previous ones stay valid for their users.
+    struct Frame {
+        CloudT::ConstPtr input;
+        Eigen::Matrix4f sensor_to_fixed;
+
+        std::mutex mutex;
+        CloudT::Ptr transformed, filtered;
+        // Cloud the indices of the last segmented planes refer to
+        CloudT::Ptr plane_frame_cloud;
+        // Points left after removing the multiple planes, indices into remaining_cloud
+        CloudT::Ptr remaining_cloud;
+        pcl::PointIndices::Ptr remaining_indices;
+
+        // Single plane, the tabletop depends on it and is reset with it
+        char plane_axis = 0;
+        CloudT::Ptr plane_cloud, plane_hull;
+        pcl::PointIndices::Ptr plane_inliers;
+        pcl::ModelCoefficients plane_coefficients;
+        // Plane message without payload, hull and statistics aren't computed again
+        point_cloud_proc::Plane plane_msg;
+
+        CloudT::Ptr tabletop;
+        pcl::search::KdTree<PointT>::Ptr tabletop_tree;
+        pcl::PointIndices::Ptr tabletop_indicies;
+        std::shared_ptr<const std::vector<pcl::PointIndices> > clusters;
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+
+    typedef std::shared_ptr<Frame> FramePtr;
+
+    // Stateful PCL objects, every query uses its own
+    struct WorkContext {
+        pcl::PassThrough<PointT> pass;
+        pcl::VoxelGrid<PointT> vg;
+        pcl::SACSegmentation<PointT> seg;
+        pcl::ExtractIndices<PointT> extract;
+        pcl::ConvexHull<PointT> chull;
+        PolygonalPrismExtractor prism;
+        pcl::RadiusOutlierRemoval<PointT> outrem;
+        pcl::ProjectInliers<PointT> plane_proj;
+        pcl::GreedyProjectionTriangulation<pcl::PointNormal> gp3;
+        pcl::IntegralImageNormalEstimation<PointT, PointNT> ine;
+        pcl::OrganizedMultiPlaneSegmentation<PointT, PointNT, pcl::Label> mps;
+        FusedCropVoxelFilter fused_filter;
+        ParallelPlaneRansac plane_ransac;
+        VoxelClustering voxel_clustering;
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+
+    // Frame held by beginFrame() for this thread, otherwise a newly acquired one
+    FramePtr getFrame();
+
+    FramePtr acquireFrame();
+
+    // Like getFrame() without acquiring, for the getters of the last results
+    FramePtr getCurrentFrame();
+
+    // The stage functions taking a frame expect its mutex to be held
+    bool transformFrame(Frame &frame);
+
+    bool filterFrame(Frame &frame, WorkContext &context);
+
+    bool segmentFramePlane(Frame &frame, WorkContext &context, char axis);
+
+    bool extractFrameTabletop(Frame &frame, WorkContext &context);
+
+    bool removeOutliers(WorkContext &context, CloudT::Ptr in, CloudT::Ptr out);
+
+    // Fixed frame points at the given indices of the organized input, invalid
+    // points are skipped. Copied from the transformed frame when there is one,
+    // takes the frame lock only to read it
+    bool getInputPoints(Frame &frame, const std::vector<int> &indices, CloudT &points);
+
+    // Only reads the cloud and search tree so clusters can be processed in parallel
+    void getObjectFromCluster(const CloudT::Ptr &cloud, const pcl::search::KdTree<PointT>::Ptr &tree,
+                              const pcl::PointIndices &cluster_indicies,
+                              const Eigen::Vector4f &plane_coef, bool compute_normals,
+                              uint8_t payload, point_cloud_proc::Object &object);
+
+    // Expects tracking_mutex_ to be held
+    bool trackPlane(const CloudT &cloud, pcl::PointIndices &inliers,
+                    pcl::ModelCoefficients &coefficients);
+
+    void selectPlaneInliers(const CloudT &cloud, const pcl::ModelCoefficients &coefficients,
+                            float dist_thresh, pcl::PointIndices &inliers);
+
+    // A non-zero axis restricts the search to planes perpendicular to it
+    bool segmentPlaneSAC(WorkContext &context, const CloudT::Ptr &cloud,
+                         const pcl::PointIndices::Ptr &indices, float dist_thresh,
+                         const Eigen::Vector3f &axis, pcl::PointIndices &inliers,
+                         pcl::ModelCoefficients &coefficients);
+
+    // Test of the pass-through filter on a transformed point, false for non finite points
+    bool isInsidePassLimits(const PointT &p) const;
+
+    // Only reads the transformed cloud of the frame, which has to be computed
+    bool segmentOrganizedPlanes(WorkContext &context, const Frame &frame, float dist_thresh,
+                                std::vector<pcl::ModelCoefficients> &coefficients,
+                                std::vector<pcl::PointIndices> &inliers);
+
+    bool segmentOrganizedMultiplePlane(WorkContext &context, const CloudT::Ptr &cloud,
+                                       const std::vector<pcl::ModelCoefficients> &plane_coefficients,
+                                       const std::vector<pcl::PointIndices> &plane_inliers,
+                                       std::vector<point_cloud_proc::Plane> &planes,
+                                       const PlaneCallback &plane_cb, uint8_t payload);
+
+    // The center is the centroid of the inliers, or of the hull like the multiple planes always had
+    void fillPlaneMsg(WorkContext &context, const CloudT::Ptr &cloud, const pcl::PointIndices::Ptr &inliers,
+                      const pcl::ModelCoefficients &coefficients, CloudT::Ptr &hull,
+                      uint8_t payload, point_cloud_proc::Plane &plane, bool hull_center = false);
+
+    void fillPlanePayload(const CloudT::Ptr &cloud, const pcl::PointIndices::Ptr &inliers,
+                          uint8_t payload, point_cloud_proc::Plane &plane);
+
+    uint8_t getPlaneOrientation(const pcl::ModelCoefficients &coefficients);
+
+    std::string getAxisName(uint8_t orientation);
+
+    CloudNT::Ptr allocateNormals();
+
+    pcl::PointIndices::Ptr allocateIndices();
+
+    ObjectPool<WorkContext> contexts_;
+    ObjectPool<CloudT> frame_cloud_pool_, cloud_pool_;
+    ObjectPool<CloudNT> normals_pool_;
+    ObjectPool<pcl::PointIndices> indices_pool_;
+
+    // The plane kept by plane_tracking is shared by the queries of all frames
+    std::mutex tracking_mutex_;
+    bool plane_tracking_, has_tracked_plane_ = false;
+    char tracked_axis_;
+    size_t tracked_plane_support_;
+    float tracking_min_ratio_;
+    point_cloud_proc::Plane tracked_plane_;
+    int k_search_, min_plane_size_, max_iter_, min_cluster_size_, max_cluster_size_, min_neighbors_;
+    float cluster_tol_, leaf_size_, eps_angle_, single_dist_thresh_, multi_dist_thresh_, radius_search_;
+    float ine_max_depth_change_, ine_smoothing_size_;
+    double sac_probability_;
+
+    std::vector<float> pass_limits_, prism_limits_, plane_prior_limits_;
+    std::string filter_mode_, plane_mode_, sac_engine_, sac_method_;
+    std::string cluster_mode_;
+
+    // A new frame replaces current_frame_, queries still running keep the one they started with.
+    // acquire_mutex_ makes acquireInputCloud() run once at a time
+    std::mutex frame_mutex_, acquire_mutex_;
+    FramePtr current_frame_;
+    std::map<std::thread::id, FramePtr> held_frames_;
+};
+
+#endif //POINT_CLOUD_PROC_CORE_H
@@ -0,0 +1,56 @@
+#ifndef POINT_CLOUD_PROC_PRISM_EXTRACTOR_H
+#define POINT_CLOUD_PROC_PRISM_EXTRACTOR_H
+
+#include <vector>
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/PointIndices.h>
+#include <Eigen/Core>
+
+#include <point_cloud_proc/soa_cloud.h>
+
+// Indices of the points inside the prism spanned by a planar polygon between
+// two heights, the same points as pcl::ExtractPolygonalPrismData. The polygon
+// is turned into one edge function per side once, every point is projected
+// on the plane once and convex polygons are tested four points at a time.
+// Heights are signed distances along the plane normal flipped toward the
+// viewpoint, the origin of the cloud frame.
+class PolygonalPrismExtractor {
+    typedef pcl::PointXYZRGB PointT;
+    typedef pcl::PointCloud<PointT> CloudT;
+
+public:
+    PolygonalPrismExtractor();
+
+    void setHeightLimits(float height_min, float height_max);
+
+    // Polygon vertices are expected in order, e.g. the output of pcl::ConvexHull
+    bool segment(const CloudT &cloud, const CloudT &polygon, pcl::PointIndices &inliers);
+
+private:
+    bool setPolygon(const CloudT &polygon);
+
+    bool isInside(float x, float y, float z) const;
+
+    // Crossing number test of pcl::isXYPointIn2DPolygon for non convex polygons
+    bool isInsidePolygon(float u, float v) const;
+
+    float height_min_, height_max_;
+
+    // Plane of the polygon, points are projected on it and then the coordinate
+    // along the largest normal component is dropped
+    Eigen::Vector4f plane_;
+    int k1_, k2_;
+
+    bool convex_;
+    float min_u_, max_u_, min_v_, max_v_;
+    std::vector<float> polygon_u_, polygon_v_;
+
+    // Inside of a convex polygon is where a * u + b * v + c >= 0 for all edges
+    std::vector<float> edge_a_, edge_b_, edge_c_;
+
+    SoACloud points_;
+};
+
+#endif //POINT_CLOUD_PROC_PRISM_EXTRACTOR_H
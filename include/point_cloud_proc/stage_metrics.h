@@ -0,0 +1,89 @@
+#ifndef POINT_CLOUD_PROC_STAGE_METRICS_H
+#define POINT_CLOUD_PROC_STAGE_METRICS_H
+
+#include <stddef.h>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Latency and point counts of the processing stages. The last window_size
+// samples of every stage are kept for the percentiles, every sample can also
+// be appended to a CSV trace file. Samples are recorded from any thread.
+class StageMetrics {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Summary {
+        std::string stage;
+        unsigned int count;
+        float last_ms, mean_ms, p50_ms, p90_ms, p99_ms;
+        unsigned int points_in, points_out;
+    };
+
+    StageMetrics();
+
+    ~StageMetrics();
+
+    void setEnabled(bool enabled) { enabled_ = enabled; }
+
+    bool isEnabled() const { return enabled_; }
+
+    void setWindowSize(int window_size);
+
+    // Trace lines are "stage,start_us,duration_us,points_in,points_out"
+    bool openTrace(const std::string &path);
+
+    void closeTrace();
+
+    void record(const std::string &stage, Clock::time_point start, Clock::time_point end,
+                size_t points_in, size_t points_out);
+
+    // Stages are sorted by name, count is the number of samples since the start
+    void getSummaries(std::vector<Summary> &summaries);
+
+private:
+    struct StageWindow {
+        std::vector<float> durations;
+        int next;
+        unsigned int count;
+        float last_ms;
+        unsigned int points_in, points_out;
+    };
+
+    bool enabled_;
+    int window_size_;
+    Clock::time_point origin_;
+    std::map<std::string, StageWindow> stages_;
+    std::ofstream trace_;
+    std::mutex mutex_;
+};
+
+// Records the time between its construction and destruction as one sample
+class StageTimer {
+public:
+    StageTimer(StageMetrics &metrics, const char *stage, size_t points_in = 0) :
+            metrics_(metrics), stage_(stage), points_in_(points_in), points_out_(0) {
+        if (metrics_.isEnabled())
+            start_ = StageMetrics::Clock::now();
+    }
+
+    ~StageTimer() {
+        if (metrics_.isEnabled())
+            metrics_.record(stage_, start_, StageMetrics::Clock::now(), points_in_, points_out_);
+    }
+
+    void setPointsIn(size_t points_in) { points_in_ = points_in; }
+
+    void setPointsOut(size_t points_out) { points_out_ = points_out; }
+
+private:
+    StageMetrics &metrics_;
+    const char *stage_;
+    size_t points_in_, points_out_;
+    StageMetrics::Clock::time_point start_;
+};
+
+#endif //POINT_CLOUD_PROC_STAGE_METRICS_H
@@ -0,0 +1,46 @@
+#ifndef POINT_CLOUD_PROC_VOXEL_CLUSTERING_H
+#define POINT_CLOUD_PROC_VOXEL_CLUSTERING_H
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/PointIndices.h>
+
+// Connected components over a hashed voxel grid. Occupied voxels that touch
+// in their 26-neighbourhood belong to the same cluster, which makes the cost
+// linear in the number of points. Clusters are returned like
+// pcl::EuclideanClusterExtraction does, sorted from the largest one.
+class VoxelClustering {
+    typedef pcl::PointXYZRGB PointT;
+    typedef pcl::PointCloud<PointT> CloudT;
+
+public:
+    VoxelClustering();
+
+    void setVoxelSize(float voxel_size) { voxel_size_ = voxel_size; }
+
+    void setMinClusterSize(int min_cluster_size) { min_cluster_size_ = min_cluster_size; }
+
+    void setMaxClusterSize(int max_cluster_size) { max_cluster_size_ = max_cluster_size; }
+
+    void extract(const CloudT &cloud, std::vector<pcl::PointIndices> &clusters);
+
+private:
+    int findRoot(int voxel);
+
+    void unite(int voxel1, int voxel2);
+
+    float voxel_size_;
+    int min_cluster_size_, max_cluster_size_;
+
+    // Kept between calls to avoid reallocations, keep the instance to benefit
+    std::vector<uint64_t> point_keys_;
+    std::vector<int> point_voxels_, voxel_parents_, voxel_labels_;
+    std::vector<uint64_t> voxel_keys_;
+    std::unordered_map<uint64_t, int> grid_;
+};
+
+#endif //POINT_CLOUD_PROC_VOXEL_CLUSTERING_H
@@ -0,0 +1,88 @@
+#include <point_cloud_proc/cluster_stats.h>
+
+#include <limits>
+
+namespace {
+
+// Accumulates the moments relative to the first point so the covariance doesn't
+// lose precision to large coordinates far from the origin
+class StatsAccumulator {
+public:
+    StatsAccumulator() : count_(0) {
+        min_.setConstant(std::numeric_limits<float>::max());
+        max_.setConstant(-std::numeric_limits<float>::max());
+        sum_.setZero();
+        sum_sqr_.setZero();
+    }
+
+    inline void add(const pcl::PointXYZRGB &p) {
+        if (!pcl::isFinite(p))
+            return;
+
+        Eigen::Array4f pt(p.x, p.y, p.z, 0.0f);
+        if (count_ == 0)
+            origin_ = pt;
+
+        min_ = min_.min(pt);
+        max_ = max_.max(pt);
+
+        Eigen::Array4d d = (pt - origin_).cast<double>();
+        sum_ += d;
+        // xx, xy, xz, unused, yy, yz, zz
+        sum_sqr_.head<4>() += d[0] * d.head<4>();
+        sum_sqr_.segment<2>(4) += d[1] * d.segment<2>(1);
+        sum_sqr_[6] += d[2] * d[2];
+        count_++;
+    }
+
+    bool finish(ClusterStats &stats) const {
+        stats.count = count_;
+        if (count_ == 0)
+            return false;
+
+        Eigen::Array4d mean = sum_ / count_;
+        Eigen::Array<double, 8, 1> moments = sum_sqr_ / count_;
+
+        Eigen::Matrix3d covariance;
+        covariance(0, 0) = moments[0] - mean[0] * mean[0];
+        covariance(0, 1) = moments[1] - mean[0] * mean[1];
+        covariance(0, 2) = moments[2] - mean[0] * mean[2];
+        covariance(1, 1) = moments[4] - mean[1] * mean[1];
+        covariance(1, 2) = moments[5] - mean[1] * mean[2];
+        covariance(2, 2) = moments[6] - mean[2] * mean[2];
+        covariance(1, 0) = covariance(0, 1);
+        covariance(2, 0) = covariance(0, 2);
+        covariance(2, 1) = covariance(1, 2);
+
+        stats.centroid = (origin_.cast<double>() + mean).head<3>().cast<float>().matrix();
+        stats.min = min_.head<3>().matrix();
+        stats.max = max_.head<3>().matrix();
+        stats.covariance = covariance.cast<float>();
+        return true;
+    }
+
+private:
+    int count_;
+    Eigen::Array4f origin_, min_, max_;
+    Eigen::Array4d sum_;
+    Eigen::Array<double, 8, 1> sum_sqr_;
+};
+
+}
+
+bool computeClusterStats(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, const std::vector<int> &indices,
+                         ClusterStats &stats) {
+    StatsAccumulator accumulator;
+    for (size_t i = 0; i < indices.size(); i++) {
+        accumulator.add(cloud.points[indices[i]]);
+    }
+    return accumulator.finish(stats);
+}
+
+bool computeClusterStats(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, ClusterStats &stats) {
+    StatsAccumulator accumulator;
+    for (size_t i = 0; i < cloud.points.size(); i++) {
+        accumulator.add(cloud.points[i]);
+    }
+    return accumulator.finish(stats);
+}
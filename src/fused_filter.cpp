@@ -0,0 +1,131 @@
+#include <point_cloud_proc/fused_filter.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Pack the three voxel coordinates into a single hash key (21 bits each)
+inline uint64_t voxelKey(int i, int j, int k) {
+    const int64_t offset = 1 << 20;
+    return (static_cast<uint64_t>(i + offset) & 0x1FFFFF) |
+           ((static_cast<uint64_t>(j + offset) & 0x1FFFFF) << 21) |
+           ((static_cast<uint64_t>(k + offset) & 0x1FFFFF) << 42);
+}
+
+}
+
+FusedCropVoxelFilter::FusedCropVoxelFilter() : inverse_leaf_size_(100.0f) {
+    for (int i = 0; i < 4; i++) {
+        min_pt_[i] = -FLT_MAX;
+        max_pt_[i] = FLT_MAX;
+    }
+}
+
+void FusedCropVoxelFilter::setLimits(const std::vector<float> &limits) {
+    for (int i = 0; i < 3; i++) {
+        min_pt_[i] = limits[2 * i];
+        max_pt_[i] = limits[2 * i + 1];
+    }
+}
+
+void FusedCropVoxelFilter::setLeafSize(float leaf_size) {
+    inverse_leaf_size_ = 1.0f / leaf_size;
+}
+
+bool FusedCropVoxelFilter::voxelLess(const Voxel &v1, const Voxel &v2) {
+    // Same ordering as the linear voxel index used by pcl::VoxelGrid
+    if (v1.k != v2.k)
+        return v1.k < v2.k;
+    if (v1.j != v2.j)
+        return v1.j < v2.j;
+    return v1.i < v2.i;
+}
+
+void FusedCropVoxelFilter::filter(const CloudT &cloud_in, CloudT &cloud_out) {
+
+    grid_.clear();
+    voxels_.clear();
+    if (grid_.bucket_count() < cloud_in.points.size() / 4)
+        grid_.reserve(cloud_in.points.size() / 4);
+
+#ifdef __SSE2__
+    const __m128 lower = _mm_loadu_ps(min_pt_);
+    const __m128 upper = _mm_loadu_ps(max_pt_);
+#endif
+
+    for (size_t n = 0; n < cloud_in.points.size(); n++) {
+        const PointT &p = cloud_in.points[n];
+
+        // Bounds test, comparisons against NaN are false so invalid points are dropped
+#ifdef __SSE2__
+        const __m128 xyz = _mm_load_ps(p.data);
+        const int inside = _mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(xyz, lower), _mm_cmple_ps(xyz, upper)));
+        if ((inside & 0x7) != 0x7)
+            continue;
+#else
+        if (!(p.x >= min_pt_[0] && p.x <= max_pt_[0] &&
+              p.y >= min_pt_[1] && p.y <= max_pt_[1] &&
+              p.z >= min_pt_[2] && p.z <= max_pt_[2]))
+            continue;
+#endif
+
+        int i = static_cast<int>(std::floor(p.x * inverse_leaf_size_));
+        int j = static_cast<int>(std::floor(p.y * inverse_leaf_size_));
+        int k = static_cast<int>(std::floor(p.z * inverse_leaf_size_));
+
+        std::pair<std::unordered_map<uint64_t, int>::iterator, bool> it =
+                grid_.insert(std::make_pair(voxelKey(i, j, k), static_cast<int>(voxels_.size())));
+
+        if (it.second) {
+            Voxel v;
+            v.i = i;
+            v.j = j;
+            v.k = k;
+            v.count = 0;
+            v.x = v.y = v.z = 0.0f;
+            v.r = v.g = v.b = 0.0f;
+            voxels_.push_back(v);
+        }
+
+        Voxel &v = voxels_[it.first->second];
+        v.count++;
+        v.x += p.x;
+        v.y += p.y;
+        v.z += p.z;
+        v.r += p.r;
+        v.g += p.g;
+        v.b += p.b;
+    }
+
+    std::sort(voxels_.begin(), voxels_.end(), &FusedCropVoxelFilter::voxelLess);
+
+    cloud_out.header = cloud_in.header;
+    cloud_out.points.resize(voxels_.size());
+    cloud_out.width = static_cast<uint32_t>(voxels_.size());
+    cloud_out.height = 1;
+    cloud_out.is_dense = true;
+
+    for (size_t n = 0; n < voxels_.size(); n++) {
+        const Voxel &v = voxels_[n];
+        const float count = static_cast<float>(v.count);
+        PointT &p = cloud_out.points[n];
+
+        p.x = v.x / count;
+        p.y = v.y / count;
+        p.z = v.z / count;
+
+        // Colour channels are averaged and truncated like pcl::VoxelGrid does,
+        // which leaves alpha at 0
+        uint32_t rgba = (static_cast<uint32_t>(v.r / count) << 16) |
+                        (static_cast<uint32_t>(v.g / count) << 8) |
+                        static_cast<uint32_t>(v.b / count);
+        std::memcpy(&p.rgb, &rgba, sizeof(float));
+    }
+}
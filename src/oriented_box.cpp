@@ -0,0 +1,70 @@
+#include <point_cloud_proc/oriented_box.h>
+
+#include <limits>
+#include <Eigen/Eigenvalues>
+
+bool estimateOrientedBox(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, const std::vector<int> &indices,
+                         const Eigen::Vector4f &plane, const ClusterStats &stats, OrientedBox &box) {
+
+    if (indices.empty() || stats.count == 0)
+        return false;
+
+    Eigen::Vector3f normal = plane.head<3>();
+    float norm = normal.norm();
+    if (norm < 1e-6f)
+        return false;
+
+    Eigen::Vector3d mean = stats.centroid.cast<double>();
+    Eigen::Matrix3d covariance = stats.covariance.cast<double>();
+
+    // Plane normal pointing towards the object
+    normal /= norm;
+    if (normal.dot(mean.cast<float>()) + plane[3] / norm < 0.0f)
+        normal = -normal;
+
+    // Covariance of the points projected on the plane
+    Eigen::Vector3d z_axis = normal.cast<double>();
+    Eigen::Vector3d u = z_axis.unitOrthogonal();
+    Eigen::Vector3d v = z_axis.cross(u);
+
+    Eigen::Matrix<double, 3, 2> basis;
+    basis << u, v;
+    Eigen::Matrix2d covariance_2d = basis.transpose() * covariance * basis;
+
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix2d> solver(covariance_2d);
+    Eigen::Vector2d major = solver.eigenvectors().col(1);
+
+    Eigen::Vector3d x_axis = (major[0] * u + major[1] * v).normalized();
+    Eigen::Vector3d y_axis = z_axis.cross(x_axis);
+
+    Eigen::Matrix3d rotation;
+    rotation << x_axis, y_axis, z_axis;
+
+    // Extents in the box frame, the only pass over the points
+    Eigen::Vector3d min_pt = Eigen::Vector3d::Constant(std::numeric_limits<double>::max());
+    Eigen::Vector3d max_pt = Eigen::Vector3d::Constant(-std::numeric_limits<double>::max());
+    int min_index = indices[0], max_index = indices[0];
+
+    for (size_t i = 0; i < indices.size(); i++) {
+        if (!pcl::isFinite(cloud.points[indices[i]]))
+            continue;
+
+        Eigen::Vector3d p = rotation.transpose() *
+                            (cloud.points[indices[i]].getVector3fMap().cast<double>() - mean);
+        if (p[0] < min_pt[0])
+            min_index = indices[i];
+        if (p[0] > max_pt[0])
+            max_index = indices[i];
+        min_pt = min_pt.cwiseMin(p);
+        max_pt = max_pt.cwiseMax(p);
+    }
+
+    box.center = (mean + rotation * (0.5 * (min_pt + max_pt))).cast<float>();
+    box.orientation = Eigen::Quaternionf(rotation.cast<float>());
+    box.orientation.normalize();
+    box.dimensions = (max_pt - min_pt).cast<float>();
+    box.major_min = cloud.points[min_index].getVector3fMap();
+    box.major_max = cloud.points[max_index].getVector3fMap();
+
+    return true;
+}
@@ -0,0 +1,303 @@
+#include <point_cloud_proc/plane_ransac.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <Eigen/Eigenvalues>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+// SplitMix64, a counter based generator with a few operations per number
+inline uint64_t splitMix(uint64_t &state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Index in [0, n) from the high bits of the next number
+inline int uniformIndex(uint64_t &state, int n) {
+    return static_cast<int>(((splitMix(state) >> 32) * static_cast<uint64_t>(n)) >> 32);
+}
+
+}
+
+ParallelPlaneRansac::ParallelPlaneRansac() :
+        method_(RANSAC), axis_(Eigen::Vector3f::Zero()), threshold_(0.01f), cos_eps_angle_(0.0f),
+        max_iterations_(1000), iterations_(0), probability_(0.99), calls_(0) {
+}
+
+void ParallelPlaneRansac::setAxis(const Eigen::Vector3f &axis, float eps_angle) {
+    axis_ = axis.isZero() ? axis : axis.normalized();
+    cos_eps_angle_ = std::cos(eps_angle);
+}
+
+bool ParallelPlaneRansac::segment(const CloudT &cloud, const std::vector<int> &indices,
+                                  pcl::PointIndices &inliers, pcl::ModelCoefficients &coefficients) {
+
+    inliers.indices.clear();
+    coefficients.values.clear();
+    inliers.header = cloud.header;
+    coefficients.header = cloud.header;
+    iterations_ = 0;
+
+    // Every call draws different samples, the sequence only depends on the number of calls
+    uint64_t call_state = calls_++;
+    const uint64_t call_seed = splitMix(call_state);
+
+    points_.assign(cloud, indices);
+
+    const int n = static_cast<int>(points_.size());
+    if (n < 3)
+        return false;
+
+#ifdef _OPENMP
+    const int batch_size = 8 * omp_get_max_threads();
+#else
+    const int batch_size = 8;
+#endif
+
+    std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> > models(batch_size);
+    std::vector<double> scores(batch_size);
+    std::vector<int> counts(batch_size);
+    std::vector<char> valid(batch_size);
+
+    Eigen::Vector4f best_model;
+    double best_score = -std::numeric_limits<double>::max();
+    int best_count = 0;
+    bool found = false;
+
+    const double log_probability = std::log(1.0 - probability_);
+    double required_iterations = max_iterations_;
+
+    while (iterations_ < required_iterations && iterations_ < max_iterations_) {
+
+        const int batch = std::min(batch_size, max_iterations_ - iterations_);
+        const int first_iteration = iterations_;
+
+#pragma omp parallel for schedule(dynamic)
+        for (int h = 0; h < batch; h++) {
+            // Keyed by the call and the iteration so the result doesn't depend on the thread count
+            uint64_t rng = call_seed ^ (static_cast<uint64_t>(first_iteration + h) * 0xD1B54A32D192ED03ULL);
+
+            int sample[3];
+            sample[0] = uniformIndex(rng, n);
+            do {
+                sample[1] = uniformIndex(rng, n);
+            } while (sample[1] == sample[0]);
+            do {
+                sample[2] = uniformIndex(rng, n);
+            } while (sample[2] == sample[0] || sample[2] == sample[1]);
+
+            valid[h] = computeModel(sample, models[h]);
+            if (valid[h])
+                scores[h] = scoreModel(models[h], counts[h]);
+        }
+
+        for (int h = 0; h < batch; h++) {
+            if (valid[h] && scores[h] > best_score) {
+                best_score = scores[h];
+                best_count = counts[h];
+                best_model = models[h];
+                found = true;
+            }
+        }
+
+        iterations_ += batch;
+
+        if (found && best_count > 0) {
+            // Iterations needed to draw one outlier free sample with the requested probability
+            double inlier_ratio = static_cast<double>(best_count) / n;
+            double p_outlier_sample = 1.0 - inlier_ratio * inlier_ratio * inlier_ratio;
+            p_outlier_sample = std::max(std::numeric_limits<double>::epsilon(), p_outlier_sample);
+            p_outlier_sample = std::min(1.0 - std::numeric_limits<double>::epsilon(), p_outlier_sample);
+            required_iterations = log_probability / std::log(p_outlier_sample);
+        }
+    }
+
+    if (!found)
+        return false;
+
+    // Least squares refinement on the inliers, then select the inliers of the refined model
+    std::vector<int> model_inliers;
+    selectInliers(best_model, model_inliers);
+
+    Eigen::Vector4f refined_model = best_model;
+    if (refineModel(model_inliers, refined_model) &&
+        (axis_.isZero() || std::abs(refined_model.head<3>().dot(axis_)) >= cos_eps_angle_)) {
+        best_model = refined_model;
+        selectInliers(best_model, model_inliers);
+    }
+
+    const std::vector<int> &source_indices = points_.sourceIndices();
+    inliers.indices.resize(model_inliers.size());
+    for (size_t i = 0; i < model_inliers.size(); i++) {
+        inliers.indices[i] = source_indices[model_inliers[i]];
+    }
+
+    coefficients.values.resize(4);
+    for (int i = 0; i < 4; i++) {
+        coefficients.values[i] = best_model[i];
+    }
+
+    return true;
+}
+
+bool ParallelPlaneRansac::computeModel(int sample[3], Eigen::Vector4f &model) const {
+
+    const SoACloud::FloatArray &x = points_.x(), &y = points_.y(), &z = points_.z();
+    const Eigen::Vector3f p0(x[sample[0]], y[sample[0]], z[sample[0]]);
+    const Eigen::Vector3f p1(x[sample[1]], y[sample[1]], z[sample[1]]);
+    const Eigen::Vector3f p2(x[sample[2]], y[sample[2]], z[sample[2]]);
+
+    Eigen::Vector3f normal = (p1 - p0).cross(p2 - p0);
+    float norm = normal.norm();
+    if (norm < 1e-8f)
+        return false;
+
+    normal /= norm;
+
+    // Reject hypotheses that are not perpendicular to the requested axis before scoring them
+    if (!axis_.isZero() && std::abs(normal.dot(axis_)) < cos_eps_angle_)
+        return false;
+
+    model << normal, -normal.dot(p0);
+    return true;
+}
+
+double ParallelPlaneRansac::scoreModel(const Eigen::Vector4f &model, int &inlier_count) const {
+
+    const float *x = points_.x().data(), *y = points_.y().data(), *z = points_.z().data();
+    const size_t n = points_.size();
+    const float threshold_sqr = threshold_ * threshold_;
+    inlier_count = 0;
+    double cost = 0.0;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128 a = _mm_set1_ps(model[0]), b = _mm_set1_ps(model[1]);
+    const __m128 c = _mm_set1_ps(model[2]), d = _mm_set1_ps(model[3]);
+    const __m128 threshold = _mm_set1_ps(threshold_), outlier_cost = _mm_set1_ps(threshold_sqr);
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const size_t simd_end = n & ~static_cast<size_t>(3);
+
+    // Costs are summed per lane in float and added to the total once per block,
+    // so MSAC scores can differ from a double sum in the last bits. Inliers are
+    // counted per lane too, subtracting the all ones compare mask adds one.
+    while (i < simd_end) {
+        const size_t block_end = std::min(simd_end, i + 1024);
+        __m128 block_cost = _mm_setzero_ps();
+        __m128i block_count = _mm_setzero_si128();
+        for (; i < block_end; i += 4) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, _mm_load_ps(x + i)),
+                                                    _mm_mul_ps(b, _mm_load_ps(y + i))),
+                                         _mm_add_ps(_mm_mul_ps(c, _mm_load_ps(z + i)), d));
+            distance = _mm_and_ps(distance, abs_mask);
+
+            const __m128 inside = _mm_cmple_ps(distance, threshold);
+            block_count = _mm_sub_epi32(block_count, _mm_castps_si128(inside));
+            block_cost = _mm_add_ps(block_cost, _mm_or_ps(_mm_and_ps(inside, _mm_mul_ps(distance, distance)),
+                                                          _mm_andnot_ps(inside, outlier_cost)));
+        }
+
+        float lanes[4];
+        _mm_storeu_ps(lanes, block_cost);
+        cost += static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+
+        int counts[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(counts), block_count);
+        inlier_count += counts[0] + counts[1] + counts[2] + counts[3];
+    }
+#endif
+
+    // Point to plane distance of the homogeneous point
+    for (; i < n; i++) {
+        float distance = std::abs(model[0] * x[i] + model[1] * y[i] + model[2] * z[i] + model[3]);
+        if (distance <= threshold_) {
+            inlier_count++;
+            cost += distance * distance;
+        } else {
+            cost += threshold_sqr;
+        }
+    }
+
+    if (method_ == MSAC)
+        return -cost;
+    return inlier_count;
+}
+
+int ParallelPlaneRansac::selectInliers(const Eigen::Vector4f &model, std::vector<int> &inliers) const {
+
+    const float *x = points_.x().data(), *y = points_.y().data(), *z = points_.z().data();
+    const size_t n = points_.size();
+    size_t i = 0;
+
+    inliers.clear();
+
+#ifdef __SSE2__
+    const __m128 a = _mm_set1_ps(model[0]), b = _mm_set1_ps(model[1]);
+    const __m128 c = _mm_set1_ps(model[2]), d = _mm_set1_ps(model[3]);
+    const __m128 threshold = _mm_set1_ps(threshold_);
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const size_t simd_end = n & ~static_cast<size_t>(3);
+
+    for (; i < simd_end; i += 4) {
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, _mm_load_ps(x + i)),
+                                                _mm_mul_ps(b, _mm_load_ps(y + i))),
+                                     _mm_add_ps(_mm_mul_ps(c, _mm_load_ps(z + i)), d));
+        int inside = _mm_movemask_ps(_mm_cmple_ps(_mm_and_ps(distance, abs_mask), threshold));
+        for (int lane = 0; inside != 0; lane++, inside >>= 1) {
+            if (inside & 1)
+                inliers.push_back(static_cast<int>(i) + lane);
+        }
+    }
+#endif
+
+    for (; i < n; i++) {
+        if (std::abs(model[0] * x[i] + model[1] * y[i] + model[2] * z[i] + model[3]) <= threshold_)
+            inliers.push_back(static_cast<int>(i));
+    }
+    return static_cast<int>(inliers.size());
+}
+
+bool ParallelPlaneRansac::refineModel(const std::vector<int> &inliers, Eigen::Vector4f &model) const {
+
+    if (inliers.size() < 3)
+        return false;
+
+    const SoACloud::FloatArray &x = points_.x(), &y = points_.y(), &z = points_.z();
+
+    Eigen::Vector3d mean = Eigen::Vector3d::Zero();
+    for (size_t i = 0; i < inliers.size(); i++) {
+        mean += Eigen::Vector3d(x[inliers[i]], y[inliers[i]], z[inliers[i]]);
+    }
+    mean /= static_cast<double>(inliers.size());
+
+    Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();
+    for (size_t i = 0; i < inliers.size(); i++) {
+        Eigen::Vector3d d = Eigen::Vector3d(x[inliers[i]], y[inliers[i]], z[inliers[i]]) - mean;
+        covariance += d * d.transpose();
+    }
+
+    // Plane normal is the eigen vector of the smallest eigen value
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(covariance);
+    if (solver.info() != Eigen::Success)
+        return false;
+
+    Eigen::Vector3d normal = solver.eigenvectors().col(0);
+
+    // Keep the orientation of the original hypothesis
+    if (normal.dot(model.head<3>().cast<double>()) < 0.0)
+        normal = -normal;
+
+    model << normal.cast<float>(), static_cast<float>(-normal.dot(mean));
+    return true;
+}
@@ -0,0 +1,1752 @@
+#include <point_cloud_proc/point_cloud_proc_core.h>
+
+namespace {
+
+// Buffers of the object sized pools above this many points are freed when
+// they come back, so those pools don't end up holding frame sized buffers
+const size_t max_pooled_points = 1 << 16;
+
+template<typename Cloud>
+void resetCloud(Cloud &cloud, size_t max_points) {
+    if (cloud.points.capacity() > max_points) {
+        decltype(cloud.points)().swap(cloud.points);
+    }
+    cloud.clear();
+    cloud.header = pcl::PCLHeader();
+    cloud.is_dense = true;
+}
+
+}
+
+PointCloudProcCore::PointCloudProcCore(const std::string &config, bool debug) :
+        debug_(debug),
+        frame_cloud_pool_(6, [](CloudT &cloud) { resetCloud(cloud, std::numeric_limits<size_t>::max()); }),
+        cloud_pool_(64, [](CloudT &cloud) { resetCloud(cloud, max_pooled_points); }),
+        normals_pool_(16, [](CloudNT &normals) { resetCloud(normals, max_pooled_points); }),
+        indices_pool_(64, [](pcl::PointIndices &indices) {
+            if (indices.indices.capacity() > max_pooled_points) {
+                std::vector<int>().swap(indices.indices);
+            }
+            indices.indices.clear();
+        }) {
+
+    parameters_ = YAML::LoadFile(config);
+    const YAML::Node &parameters = parameters_;
+
+    // General parameters
+    fixed_frame_ = parameters["fixed_frame"].as<std::string>();
+
+    // Segmentation parameters
+    eps_angle_ = parameters["segmentation"]["sac_eps_angle"].as<float>();
+    single_dist_thresh_ = parameters["segmentation"]["sac_dist_thresh_single"].as<float>();
+    multi_dist_thresh_ = parameters["segmentation"]["sac_dist_thresh_multi"].as<float>();
+    min_plane_size_ = parameters["segmentation"]["sac_min_plane_size"].as<int>();
+    max_iter_ = parameters["segmentation"]["sac_max_iter"].as<int>();
+    sac_engine_ = parameters["segmentation"]["sac_engine"] ?
+                  parameters["segmentation"]["sac_engine"].as<std::string>() : "pcl";
+    sac_method_ = parameters["segmentation"]["sac_method"] ?
+                  parameters["segmentation"]["sac_method"].as<std::string>() : "ransac";
+    sac_probability_ = parameters["segmentation"]["sac_probability"] ?
+                       parameters["segmentation"]["sac_probability"].as<double>() : 0.99;
+    plane_tracking_ = parameters["segmentation"]["plane_tracking"] ?
+                      parameters["segmentation"]["plane_tracking"].as<bool>() : false;
+    tracking_min_ratio_ = parameters["segmentation"]["plane_tracking_min_ratio"] ?
+                          parameters["segmentation"]["plane_tracking_min_ratio"].as<float>() : 0.8;
+    if (parameters["segmentation"]["plane_prior_limits"])
+        plane_prior_limits_ = parameters["segmentation"]["plane_prior_limits"].as<std::vector<float>>();
+    k_search_ = parameters["segmentation"]["ne_k_search"].as<int>();
+    plane_mode_ = parameters["segmentation"]["plane_mode"] ?
+                  parameters["segmentation"]["plane_mode"].as<std::string>() : "ransac";
+    ine_max_depth_change_ = parameters["segmentation"]["ine_max_depth_change"] ?
+                            parameters["segmentation"]["ine_max_depth_change"].as<float>() : 0.02;
+    ine_smoothing_size_ = parameters["segmentation"]["ine_smoothing_size"] ?
+                          parameters["segmentation"]["ine_smoothing_size"].as<float>() : 10.0;
+    cluster_tol_ = parameters["segmentation"]["ec_cluster_tol"].as<float>();
+    min_cluster_size_ = parameters["segmentation"]["ec_min_cluster_size"].as<int>();
+    max_cluster_size_ = parameters["segmentation"]["ec_max_cluster_size"].as<int>();
+    cluster_mode_ = parameters["segmentation"]["ec_mode"] ?
+                    parameters["segmentation"]["ec_mode"].as<std::string>() : "euclidean";
+
+    // Filter parameters
+    leaf_size_ = parameters["filters"]["leaf_size"].as<float>();
+    pass_limits_ = parameters["filters"]["pass_limits"].as<std::vector<float>>();
+    prism_limits_ = parameters["filters"]["prism_limits"].as<std::vector<float>>();
+    min_neighbors_ = parameters["filters"]["outlier_min_neighbors"].as<int>();
+    radius_search_ = parameters["filters"]["outlier_radius_search"].as<float>();
+    filter_mode_ = parameters["filters"]["filter_mode"] ?
+                   parameters["filters"]["filter_mode"].as<std::string>() : "pcl";
+
+    // Metrics parameters
+    if (parameters["metrics"]) {
+        metrics_.setEnabled(parameters["metrics"]["enabled"] ?
+                            parameters["metrics"]["enabled"].as<bool>() : false);
+        metrics_.setWindowSize(parameters["metrics"]["window"] ?
+                               parameters["metrics"]["window"].as<int>() : 100);
+        std::string trace_file = parameters["metrics"]["trace_file"] ?
+                                 parameters["metrics"]["trace_file"].as<std::string>() : "";
+        if (metrics_.isEnabled() && !trace_file.empty() && !metrics_.openTrace(trace_file)) {
+            std::cout << "PCP: couldn't open trace file " << trace_file << std::endl;
+        }
+    }
+}
+
+PointCloudProcCore::~PointCloudProcCore() {
+}
+
+void PointCloudProcCore::setInputCloud(const CloudT::Ptr &cloud, const Eigen::Matrix4f &sensor_to_fixed) {
+
+    // Results of the previous frame are stale from here on
+    FramePtr frame(new Frame);
+    frame->input = cloud;
+    frame->sensor_to_fixed = sensor_to_fixed;
+
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    current_frame_ = frame;
+}
+
+void PointCloudProcCore::setInputCloud(const CloudT::Ptr &cloud) {
+    setInputCloud(cloud, Eigen::Matrix4f::Identity());
+}
+
+void PointCloudProcCore::clearInputCloud() {
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    current_frame_.reset();
+}
+
+bool PointCloudProcCore::acquireInputCloud() {
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    return static_cast<bool>(current_frame_);
+}
+
+PointCloudProcCore::FramePtr PointCloudProcCore::acquireFrame() {
+
+    std::lock_guard<std::mutex> acquire_lock(acquire_mutex_);
+    if (!acquireInputCloud()) {
+        return FramePtr();
+    }
+
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    return current_frame_;
+}
+
+PointCloudProcCore::FramePtr PointCloudProcCore::getFrame() {
+    {
+        std::lock_guard<std::mutex> lock(frame_mutex_);
+        std::map<std::thread::id, FramePtr>::const_iterator held = held_frames_.find(std::this_thread::get_id());
+        if (held != held_frames_.end()) {
+            return held->second;
+        }
+    }
+    return acquireFrame();
+}
+
+PointCloudProcCore::FramePtr PointCloudProcCore::getCurrentFrame() {
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    std::map<std::thread::id, FramePtr>::const_iterator held = held_frames_.find(std::this_thread::get_id());
+    if (held != held_frames_.end()) {
+        return held->second;
+    }
+    return current_frame_;
+}
+
+bool PointCloudProcCore::beginFrame() {
+
+    FramePtr frame = acquireFrame();
+
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    if (!frame) {
+        held_frames_.erase(std::this_thread::get_id());
+        return false;
+    }
+    held_frames_[std::this_thread::get_id()] = frame;
+    return true;
+}
+
+void PointCloudProcCore::endFrame() {
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    held_frames_.erase(std::this_thread::get_id());
+}
+
+bool PointCloudProcCore::transformPointCloud() {
+
+    FramePtr frame = getFrame();
+    if (!frame) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(frame->mutex);
+    return transformFrame(*frame);
+}
+
+bool PointCloudProcCore::transformFrame(Frame &frame) {
+
+    if (frame.transformed) {
+        return true;
+    }
+
+    StageTimer timer(metrics_, "transform", frame.input->points.size());
+
+    CloudT::Ptr transformed = allocateFrameCloud();
+    pcl::transformPointCloud(*frame.input, *transformed, frame.sensor_to_fixed);
+    transformed->header.frame_id = fixed_frame_;
+    frame.transformed = transformed;
+
+    timer.setPointsOut(transformed->points.size());
+    std::cout << "PCP: point cloud is transformed!" << std::endl;
+    return true;
+}
+
+PointCloudProcCore::CloudT::Ptr PointCloudProcCore::allocateFrameCloud() {
+    return frame_cloud_pool_.acquireShared<CloudT::Ptr>();
+}
+
+PointCloudProcCore::CloudT::Ptr PointCloudProcCore::allocateCloud() {
+    return cloud_pool_.acquireShared<CloudT::Ptr>();
+}
+
+PointCloudProcCore::CloudNT::Ptr PointCloudProcCore::allocateNormals() {
+    return normals_pool_.acquireShared<CloudNT::Ptr>();
+}
+
+pcl::PointIndices::Ptr PointCloudProcCore::allocateIndices() {
+    return indices_pool_.acquireShared<pcl::PointIndices::Ptr>();
+}
+
+bool PointCloudProcCore::getInputPoints(Frame &frame, const std::vector<int> &indices, CloudT &points) {
+
+    const CloudT &input = *frame.input;
+    if (!input.isOrganized()) {
+        std::cout << "PCP: point cloud is not organized!" << std::endl;
+        return false;
+    }
+
+    StageTimer timer(metrics_, "roi_transform", indices.size());
+
+    points.clear();
+    points.header = input.header;
+    points.header.frame_id = fixed_frame_;
+    points.reserve(indices.size());
+
+    // Reuse the frame if an earlier query already transformed it, the cloud
+    // isn't modified once it is set so it can be read without the lock
+    CloudT::ConstPtr transformed;
+    {
+        std::lock_guard<std::mutex> lock(frame.mutex);
+        transformed = frame.transformed;
+    }
+
+    Eigen::Affine3f transform(frame.sensor_to_fixed);
+
+    for (int i = 0; i < indices.size(); i++) {
+        if (indices[i] < 0 || indices[i] >= input.points.size() ||
+            !pcl::isFinite(input.points[indices[i]]))
+            continue;
+
+        if (transformed) {
+            points.push_back(transformed->points[indices[i]]);
+        } else {
+            PointT p = input.points[indices[i]];
+            p.getVector3fMap() = transform * p.getVector3fMap();
+            points.push_back(p);
+        }
+    }
+
+    timer.setPointsOut(points.size());
+    return true;
+}
+
+bool PointCloudProcCore::filterPointCloud() {
+
+    FramePtr frame = getFrame();
+    if (!frame) {
+        return false;
+    }
+
+    ObjectPool<WorkContext>::Handle context = contexts_.acquire();
+    std::lock_guard<std::mutex> lock(frame->mutex);
+    return filterFrame(*frame, *context);
+}
+
+bool PointCloudProcCore::filterFrame(Frame &frame, WorkContext &context) {
+
+    if (frame.filtered) {
+        return true;
+    }
+
+    if (!transformFrame(frame)) {
+        return false;
+    }
+
+    CloudT::Ptr cloud_transformed = frame.transformed;
+    CloudT::Ptr cloud_filtered = allocateFrameCloud();
+
+    if (filter_mode_ == "fused") {
+        // Crop, remove NaNs and downsample in a single pass
+        StageTimer timer(metrics_, "fused_filter", cloud_transformed->points.size());
+        context.fused_filter.setLimits(pass_limits_);
+        context.fused_filter.setLeafSize(leaf_size_);
+        context.fused_filter.filter(*cloud_transformed, *cloud_filtered);
+        timer.setPointsOut(cloud_filtered->points.size());
+
+        std::cout << "PCP: point cloud is filtered!" << std::endl;
+        if (cloud_filtered->points.size() == 0) {
+            std::cout << "PCP: point cloud is empty after filtering!" << std::endl;
+            return false;
+        }
+
+        frame.filtered = cloud_filtered;
+        return true;
+    }
+
+    // Remove part of the scene to leave table and objects alone. The filters
+    // alternate between two pooled clouds, PCL copies in-place filtering
+    CloudT::Ptr cloud_cropped = allocateFrameCloud();
+    {
+        StageTimer timer(metrics_, "passthrough", cloud_transformed->points.size());
+
+        pcl::PassThrough<PointT> &pass = context.pass;
+        pass.setInputCloud(cloud_transformed);
+        pass.setFilterFieldName("x");
+        pass.setFilterLimits(pass_limits_[0], pass_limits_[1]);
+        pass.filter(*cloud_cropped);
+        pass.setInputCloud(cloud_cropped);
+        pass.setFilterFieldName("y");
+        pass.setFilterLimits(pass_limits_[2], pass_limits_[3]);
+        pass.filter(*cloud_filtered);
+        pass.setInputCloud(cloud_filtered);
+        pass.setFilterFieldName("z");
+        pass.setFilterLimits(pass_limits_[4], pass_limits_[5]);
+        pass.filter(*cloud_cropped);
+
+        timer.setPointsOut(cloud_cropped->points.size());
+    }
+
+    std::cout << "PCP: point cloud is filtered!" << std::endl;
+    if (cloud_cropped->points.size() == 0) {
+        std::cout << "PCP: point cloud is empty after filtering!" << std::endl;
+        return false;
+    }
+
+    // Downsample point cloud
+    StageTimer timer(metrics_, "voxel", cloud_cropped->points.size());
+  context.vg.setInputCloud (cloud_cropped);
+  context.vg.setLeafSize (leaf_size_, leaf_size_, leaf_size_);
+  context.vg.filter (*cloud_filtered);
+    timer.setPointsOut(cloud_filtered->points.size());
+
+    frame.filtered = cloud_filtered;
+    return true;
+}
+
+bool PointCloudProcCore::removeOutliers(CloudT::Ptr in, CloudT::Ptr out) {
+    ObjectPool<WorkContext>::Handle context = contexts_.acquire();
+    return removeOutliers(*context, in, out);
+}
+
+bool PointCloudProcCore::removeOutliers(WorkContext &context, CloudT::Ptr in, CloudT::Ptr out) {
+
+    context.outrem.setInputCloud(in);
+    context.outrem.setRadiusSearch(radius_search_);
+    context.outrem.setMinNeighborsInRadius(min_neighbors_);
+    context.outrem.filter(*out);
+
+    return true;
+}
+
+bool PointCloudProcCore::segmentSinglePlane(point_cloud_proc::Plane &plane, char axis, uint8_t payload) {
+    std::cout << "PCP: segmenting single plane..." << std::endl;
+
+    FramePtr frame = getFrame();
+    if (!frame) {
+        std::cout << "PCP: couldn't transform point cloud!" << std::endl;
+        return false;
+    }
+
+    ObjectPool<WorkContext>::Handle context = contexts_.acquire();
+    CloudT::Ptr plane_cloud;
+    pcl::PointIndices::Ptr inliers;
+    {
+        std::lock_guard<std::mutex> lock(frame->mutex);
+        if (!segmentFramePlane(*frame, *context, axis)) {
+            return false;
+        }
+
+        plane = frame->plane_msg;
+        plane_cloud = frame->plane_cloud;
+        inliers = frame->plane_inliers;
+        frame->plane_frame_cloud = plane_cloud;
+    }
+
+    // The payload only reads the plane results, other queries of the frame can go on
+    fillPlanePayload(plane_cloud, inliers, payload, plane);
+    return true;
+}
+
+bool PointCloudProcCore::segmentFramePlane(Frame &frame, WorkContext &context, char axis) {
+
+    if (!filterFrame(frame, context)) {
+        std::cout << "PCP: couldn't filter point cloud!" << std::endl;
+        return false;
+    }
+
+    // The plane of this frame was already segmented by a previous query
+    if (frame.plane_axis == axis) {
+        return true;
+    }
+
+    pcl::ModelCoefficients::Ptr coefficients(new pcl::ModelCoefficients);
+    pcl::PointIndices::Ptr inliers = allocateIndices();
+
+    Eigen::Vector3f axis_vector = Eigen::Vector3f(0.0, 0.0, 0.0);
+
+    if (axis == 'x') {
+        axis_vector[0] = 1.0;
+    } else if (axis == 'y') {
+        axis_vector[1] = 1.0;
+    } else if (axis == 'z') {
+        axis_vector[2] = 1.0;
+    }
+
+    CloudT::Ptr cloud_filtered = frame.filtered;
+    CloudT::Ptr plane_cloud = cloud_filtered;
+
+    // Reuse the previous plane as long as it still explains the new cloud
+    bool tracked = false;
+    {
+        std::lock_guard<std::mutex> lock(tracking_mutex_);
+        if (plane_tracking_ && has_tracked_plane_ && tracked_axis_ == axis) {
+            tracked = trackPlane(*cloud_filtered, *inliers, *coefficients);
+        }
+    }
+
+    if (tracked) {
+        std::cout << "PCP: tracked plane is verified!" << std::endl;
+    } else if (plane_mode_ == "organized") {
+        std::vector<pcl::ModelCoefficients> plane_coefficients;
+        std::vector<pcl::PointIndices> plane_inliers;
+        if (!segmentOrganizedPlanes(context, frame, single_dist_thresh_, plane_coefficients, plane_inliers)) {
+            return false;
+        }
+
+        // Pick the largest plane perpendicular to the requested axis
+        int best = -1;
+        for (int i = 0; i < plane_coefficients.size(); i++) {
+            Eigen::Vector3f normal(plane_coefficients[i].values[0],
+                                   plane_coefficients[i].values[1],
+                                   plane_coefficients[i].values[2]);
+            normal.normalize();
+            if (!axis_vector.isZero() &&
+                std::abs(normal.dot(axis_vector)) < std::cos(eps_angle_ * (M_PI / 180.0f)))
+                continue;
+            if (best < 0 || plane_inliers[i].indices.size() > plane_inliers[best].indices.size())
+                best = i;
+        }
+
+        if (best >= 0) {
+            *coefficients = plane_coefficients[best];
+            inliers->indices.swap(plane_inliers[best].indices);
+            inliers->header = plane_inliers[best].header;
+        }
+
+        // Organized segmentation indexes the full resolution cloud
+        plane_cloud = frame.transformed;
+    } else {
+        // Only feed the points around the expected plane height along the axis
+        pcl::PointIndices::Ptr prior_indices;
+        if (plane_prior_limits_.size() == 2 && !axis_vector.isZero()) {
+            prior_indices = allocateIndices();
+            prior_indices->indices.reserve(cloud_filtered->points.size());
+            for (int i = 0; i < cloud_filtered->points.size(); i++) {
+                float height = cloud_filtered->points[i].getVector3fMap().dot(axis_vector);
+                if (height >= plane_prior_limits_[0] && height <= plane_prior_limits_[1])
+                    prior_indices->indices.push_back(i);
+            }
+        }
+
+        segmentPlaneSAC(context, cloud_filtered, prior_indices, single_dist_thresh_, axis_vector,
+                        *inliers, *coefficients);
+    }
+
+
+    if (inliers->indices.size() == 0) {
+        std::cout << "PCP: plane is empty!" << std::endl;
+        return false;
+    }
+
+    CloudT::Ptr hull = allocateCloud();
+    point_cloud_proc::Plane plane;
+    fillPlaneMsg(context, plane_cloud, inliers, *coefficients, hull, point_cloud_proc::Plane::PAYLOAD_NONE, plane);
+
+    // Keep the plane for the following queries on this frame, the tabletop
+    // depends on it and has to be extracted again
+    frame.plane_cloud = plane_cloud;
+    frame.plane_hull = hull;
+    frame.plane_inliers = inliers;
+    frame.plane_coefficients = *coefficients;
+    frame.plane_msg = plane;
+    frame.plane_axis = axis;
+    frame.tabletop.reset();
+    frame.tabletop_tree.reset();
+    frame.tabletop_indicies.reset();
+    frame.clusters.reset();
+
+    if (plane_tracking_ && !tracked) {
+        // Reference support of the plane, measured on the filtered cloud used for tracking
+        pcl::PointIndices filtered_inliers;
+        selectPlaneInliers(*cloud_filtered, *coefficients, single_dist_thresh_, filtered_inliers);
+
+        std::lock_guard<std::mutex> lock(tracking_mutex_);
+        tracked_plane_ = plane;
+        tracked_axis_ = axis;
+        tracked_plane_support_ = filtered_inliers.indices.size();
+        has_tracked_plane_ = true;
+    }
+
+    if (debug_) {
+        std::cout << "PCP: # of points in plane: " << plane.size.data << std::endl;
+        CloudT::Ptr debug_plane = allocateCloud();
+        pcl::copyPointCloud(*plane_cloud, *inliers, *debug_plane);
+        publishPlaneCloud(*debug_plane);
+    }
+
+    return true;
+}
+
+bool PointCloudProcCore::trackPlane(const CloudT &cloud, pcl::PointIndices &inliers,
+                                    pcl::ModelCoefficients &coefficients) {
+
+    StageTimer timer(metrics_, "plane_tracking", cloud.points.size());
+
+    coefficients.header = cloud.header;
+    coefficients.values.resize(4);
+    for (int i = 0; i < 4; i++) {
+        coefficients.values[i] = tracked_plane_.coef[i];
+    }
+
+    selectPlaneInliers(cloud, coefficients, single_dist_thresh_, inliers);
+    timer.setPointsOut(inliers.indices.size());
+
+    if (inliers.indices.size() < tracking_min_ratio_ * tracked_plane_support_) {
+        std::cout << "PCP: tracked plane lost, " << inliers.indices.size() << " of "
+                  << tracked_plane_support_ << " points left" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void PointCloudProcCore::selectPlaneInliers(const CloudT &cloud, const pcl::ModelCoefficients &coefficients,
+                                            float dist_thresh, pcl::PointIndices &inliers) {
+
+    Eigen::Vector4f coef(coefficients.values[0], coefficients.values[1],
+                         coefficients.values[2], coefficients.values[3]);
+
+    inliers.header = cloud.header;
+    inliers.indices.clear();
+    for (int i = 0; i < cloud.points.size(); i++) {
+        const PointT &p = cloud.points[i];
+        if (std::abs(coef.dot(Eigen::Vector4f(p.x, p.y, p.z, 1.0f))) <= dist_thresh)
+            inliers.indices.push_back(i);
+    }
+}
+
+void PointCloudProcCore::resetPlaneTracking() {
+    std::lock_guard<std::mutex> lock(tracking_mutex_);
+    has_tracked_plane_ = false;
+}
+
+bool PointCloudProcCore::segmentMultiplePlane(std::vector<point_cloud_proc::Plane> &planes,
+                                          const PlaneCallback &plane_cb, uint8_t payload) {
+
+    FramePtr frame = getFrame();
+    if (!frame) {
+        std::cout << "PCP: couldn't transform point cloud!" << std::endl;
+        return false;
+    }
+
+    ObjectPool<WorkContext>::Handle context = contexts_.acquire();
+
+    // Only the shared stages hold the frame, the planes are segmented in parallel with other queries
+    if (plane_mode_ == "organized") {
+        CloudT::Ptr cloud_transformed;
+        {
+            std::lock_guard<std::mutex> lock(frame->mutex);
+            if (!transformFrame(*frame)) {
+                return false;
+            }
+            cloud_transformed = frame->transformed;
+        }
+
+        std::vector<pcl::ModelCoefficients> plane_coefficients;
+        std::vector<pcl::PointIndices> plane_inliers;
+        if (!segmentOrganizedPlanes(*context, *frame, multi_dist_thresh_, plane_coefficients, plane_inliers) ||
+            !segmentOrganizedMultiplePlane(*context, cloud_transformed, plane_coefficients, plane_inliers,
+                                           planes, plane_cb, payload)) {
+            return false;
+        }
+
+        // Every point which passed the filter of segmentOrganizedPlanes() but isn't part of a plane
+        std::vector<char> in_plane(cloud_transformed->points.size(), 0);
+        for (int i = 0; i < plane_inliers.size(); i++) {
+            for (int j = 0; j < plane_inliers[i].indices.size(); j++) {
+                in_plane[plane_inliers[i].indices[j]] = 1;
+            }
+        }
+        pcl::PointIndices::Ptr remaining = allocateIndices();
+        for (int i = 0; i < in_plane.size(); i++) {
+            if (!in_plane[i] && isInsidePassLimits(cloud_transformed->points[i])) {
+                remaining->indices.push_back(i);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(frame->mutex);
+        frame->plane_frame_cloud = cloud_transformed;
+        frame->remaining_cloud = cloud_transformed;
+        frame->remaining_indices = remaining;
+        return true;
+    }
+
+    CloudT::Ptr cloud_filtered;
+    {
+        std::lock_guard<std::mutex> lock(frame->mutex);
+        if (!filterFrame(*frame, *context)) {
+            std::cout << "PCP: couldn't filter point cloud!" << std::endl;
+            return false;
+        }
+        cloud_filtered = frame->filtered;
+    }
+
+    int no_planes = 1;
+    CloudT::Ptr cloud_hull = allocateCloud();
+    pcl::PointIndices::Ptr plane_indices = allocateIndices();
+
+    // Planes are removed from this index set instead of copying the remaining points
+    pcl::PointIndices::Ptr remaining = allocateIndices();
+    pcl::PointIndices::Ptr outliers = allocateIndices();
+    remaining->indices.resize(cloud_filtered->points.size());
+    for (int i = 0; i < remaining->indices.size(); i++) {
+        remaining->indices[i] = i;
+    }
+
+    while (remaining->indices.size() >= min_plane_size_) {
+
+        pcl::ModelCoefficients::Ptr coefficients(new pcl::ModelCoefficients);
+        pcl::PointIndices::Ptr inliers = allocateIndices();
+        segmentPlaneSAC(*context, cloud_filtered, remaining, multi_dist_thresh_, Eigen::Vector3f::Zero(),
+                        *inliers, *coefficients);
+
+        if (inliers->indices.size() < min_plane_size_) {
+            break;
+        }
+
+        point_cloud_proc::Plane plane_object_msg;
+        fillPlaneMsg(*context, cloud_filtered, inliers, *coefficients, cloud_hull, payload, plane_object_msg, true);
+
+        std::cout << "PCP: " << no_planes << ". plane segmented! # of points: "
+                  << inliers->indices.size() << " axis: " << getAxisName(plane_object_msg.orientation) << std::endl;
+        no_planes++;
+
+        planes.push_back(plane_object_msg);
+        if (plane_cb) {
+            plane_cb(plane_object_msg);
+        }
+
+        // Remove the plane inliers from the remaining indices
+        std::sort(inliers->indices.begin(), inliers->indices.end());
+        outliers->indices.clear();
+        std::set_difference(remaining->indices.begin(), remaining->indices.end(),
+                            inliers->indices.begin(), inliers->indices.end(),
+                            std::back_inserter(outliers->indices));
+        remaining.swap(outliers);
+
+        if (debug_) {
+            plane_indices->indices.insert(plane_indices->indices.end(),
+                                          inliers->indices.begin(), inliers->indices.end());
+        }
+    }
+
+    if (planes.empty()) {
+        std::cout << "PCP: no plane found!!!" << std::endl;
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(frame->mutex);
+        frame->plane_frame_cloud = cloud_filtered;
+        frame->remaining_cloud = cloud_filtered;
+        frame->remaining_indices = remaining;
+    }
+
+    if (debug_) {
+        CloudT::Ptr plane_clouds = allocateCloud();
+        pcl::copyPointCloud(*cloud_filtered, *plane_indices, *plane_clouds);
+        publishPlaneCloud(*plane_clouds);
+    }
+
+
+    return true;
+}
+
+bool PointCloudProcCore::segmentPlaneSAC(WorkContext &context, const CloudT::Ptr &cloud,
+                                         const pcl::PointIndices::Ptr &indices, float dist_thresh,
+                                         const Eigen::Vector3f &axis, pcl::PointIndices &inliers,
+                                         pcl::ModelCoefficients &coefficients) {
+
+    if (indices && indices->indices.size() < 3) {
+        inliers.indices.clear();
+        return false;
+    }
+
+    const float eps_angle = eps_angle_ * (M_PI / 180.0f);
+
+    StageTimer timer(metrics_, "ransac", indices ? indices->indices.size() : cloud->points.size());
+
+    // PROSAC is only available through PCL
+    if (sac_engine_ == "parallel" && sac_method_ != "prosac") {
+        const std::vector<int> all_indices;
+        ParallelPlaneRansac &plane_ransac = context.plane_ransac;
+        plane_ransac.setMethod(sac_method_ == "msac" ? ParallelPlaneRansac::MSAC : ParallelPlaneRansac::RANSAC);
+        plane_ransac.setDistanceThreshold(dist_thresh);
+        plane_ransac.setMaxIterations(max_iter_);
+        plane_ransac.setProbability(sac_probability_);
+        plane_ransac.setAxis(axis, eps_angle);
+        bool success = plane_ransac.segment(*cloud, indices ? indices->indices : all_indices,
+                                            inliers, coefficients);
+        timer.setPointsOut(inliers.indices.size());
+
+        if (debug_) {
+            std::cout << "PCP: plane fitting stopped after " << plane_ransac.getIterations()
+                      << " iterations" << std::endl;
+        }
+        return success;
+    }
+
+    int method = pcl::SAC_RANSAC;
+    if (sac_method_ == "msac") {
+        method = pcl::SAC_MSAC;
+    } else if (sac_method_ == "prosac") {
+        method = pcl::SAC_PROSAC;
+    }
+
+    pcl::SACSegmentation<PointT> &seg = context.seg;
+    seg.setOptimizeCoefficients(true);
+    if (axis.isZero()) {
+        seg.setModelType(pcl::SACMODEL_PLANE);
+    } else {
+        seg.setModelType(pcl::SACMODEL_PERPENDICULAR_PLANE);
+        seg.setAxis(axis);
+        seg.setEpsAngle(eps_angle);
+    }
+    seg.setMethodType(method);
+    seg.setMaxIterations(max_iter_);
+    seg.setProbability(sac_probability_);
+    seg.setDistanceThreshold(dist_thresh);
+    seg.setInputCloud(cloud);
+    if (indices) {
+        seg.setIndices(indices);
+    } else {
+        seg.setIndices(pcl::IndicesPtr());
+    }
+    seg.segment(inliers, coefficients);
+    timer.setPointsOut(inliers.indices.size());
+
+    return !inliers.indices.empty();
+}
+
+bool PointCloudProcCore::segmentOrganizedMultiplePlane(WorkContext &context, const CloudT::Ptr &cloud,
+                                                       const std::vector<pcl::ModelCoefficients> &plane_coefficients,
+                                                       const std::vector<pcl::PointIndices> &plane_inliers,
+                                                       std::vector<point_cloud_proc::Plane> &planes,
+                                                       const PlaneCallback &plane_cb, uint8_t payload) {
+
+    CloudT::Ptr cloud_hull = allocateCloud();
+    pcl::PointIndices::Ptr inliers = allocateIndices();
+
+    for (int i = 0; i < plane_coefficients.size(); i++) {
+        inliers->header = plane_inliers[i].header;
+        inliers->indices = plane_inliers[i].indices;
+
+        point_cloud_proc::Plane plane_object_msg;
+        fillPlaneMsg(context, cloud, inliers, plane_coefficients[i], cloud_hull, payload, plane_object_msg, true);
+
+        std::cout << "PCP: " << i + 1 << ". plane segmented! # of points: "
+                  << inliers->indices.size() << " axis: " << getAxisName(plane_object_msg.orientation) << std::endl;
+
+        planes.push_back(plane_object_msg);
+        if (plane_cb) {
+            plane_cb(plane_object_msg);
+        }
+    }
+
+    if (planes.empty()) {
+        std::cout << "PCP: no plane found!!!" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool PointCloudProcCore::isInsidePassLimits(const PointT &p) const {
+    // Comparisons against NaN are false so invalid points are outside
+    return p.x >= pass_limits_[0] && p.x <= pass_limits_[1] &&
+           p.y >= pass_limits_[2] && p.y <= pass_limits_[3] &&
+           p.z >= pass_limits_[4] && p.z <= pass_limits_[5];
+}
+
+bool PointCloudProcCore::segmentOrganizedPlanes(WorkContext &context, const Frame &frame, float dist_thresh,
+                                                std::vector<pcl::ModelCoefficients> &coefficients,
+                                                std::vector<pcl::PointIndices> &inliers) {
+
+    const CloudT &cloud_transformed = *frame.transformed;
+    if (!cloud_transformed.isOrganized()) {
+        std::cout << "PCP: point cloud is not organized!" << std::endl;
+        return false;
+    }
+
+    StageTimer timer(metrics_, "organized_planes", cloud_transformed.points.size());
+
+    // Integral image normals expect the sensor frame, which the input still is in.
+    // Points outside of the pass limits are invalidated instead of removed so the
+    // organized structure is kept.
+    Eigen::Matrix4f fixed_to_sensor = frame.sensor_to_fixed.inverse();
+
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    CloudT::Ptr cloud_sensor = allocateFrameCloud();
+    *cloud_sensor = *frame.input;
+    cloud_sensor->is_dense = false;
+
+    for (int i = 0; i < cloud_sensor->points.size(); i++) {
+        if (!isInsidePassLimits(cloud_transformed.points[i])) {
+            PointT &p = cloud_sensor->points[i];
+            p.x = p.y = p.z = nan;
+        }
+    }
+
+    CloudNT::Ptr normals = allocateNormals();
+    pcl::IntegralImageNormalEstimation<PointT, PointNT> &ne = context.ine;
+    ne.setNormalEstimationMethod(ne.COVARIANCE_MATRIX);
+    ne.setMaxDepthChangeFactor(ine_max_depth_change_);
+    ne.setNormalSmoothingSize(ine_smoothing_size_);
+    ne.setInputCloud(cloud_sensor);
+    ne.compute(*normals);
+
+    pcl::OrganizedMultiPlaneSegmentation<PointT, PointNT, pcl::Label> &mps = context.mps;
+    mps.setMinInliers(min_plane_size_);
+    mps.setAngularThreshold(eps_angle_ * (M_PI / 180.0f));
+    mps.setDistanceThreshold(dist_thresh);
+    mps.setInputNormals(normals);
+    mps.setInputCloud(cloud_sensor);
+    mps.segment(coefficients, inliers);
+    timer.setPointsOut(coefficients.size());
+
+    // Express the plane coefficients in the fixed frame, inlier indices are
+    // the same since both clouds share the organized layout
+    Eigen::Matrix4f plane_transform = fixed_to_sensor.transpose();
+    for (int i = 0; i < coefficients.size(); i++) {
+        Eigen::Vector4f coef(coefficients[i].values[0], coefficients[i].values[1],
+                             coefficients[i].values[2], coefficients[i].values[3]);
+        coef = plane_transform * coef;
+        for (int j = 0; j < 4; j++) {
+            coefficients[i].values[j] = coef[j];
+        }
+        coefficients[i].header = cloud_transformed.header;
+    }
+
+    std::cout << "PCP: organized segmentation found " << coefficients.size() << " planes" << std::endl;
+    return true;
+}
+
+void PointCloudProcCore::fillPlaneMsg(WorkContext &context, const CloudT::Ptr &cloud,
+                                      const pcl::PointIndices::Ptr &inliers,
+                                      const pcl::ModelCoefficients &coefficients, CloudT::Ptr &hull,
+                                      uint8_t payload, point_cloud_proc::Plane &plane, bool hull_center) {
+
+    {
+        StageTimer timer(metrics_, "hull", inliers->indices.size());
+        hull->clear();
+        context.chull.setInputCloud(cloud);
+        context.chull.setIndices(inliers);
+        context.chull.setDimension(2);
+        context.chull.reconstruct(*hull);
+        timer.setPointsOut(hull->points.size());
+    }
+
+    fillPlanePayload(cloud, inliers, payload, plane);
+
+    // Construct plane object msg
+    pcl_conversions::fromPCL(cloud->header, plane.header);
+
+    // Get plane center, min and max values
+    ClusterStats stats;
+    computeClusterStats(*cloud, inliers->indices, stats);
+
+    Eigen::Vector4f center(stats.centroid[0], stats.centroid[1], stats.centroid[2], 1.0f);
+    if (hull_center) {
+        pcl::compute3DCentroid(*hull, center);
+    }
+
+    plane.center.x = center[0];
+    plane.center.y = center[1];
+    plane.center.z = center[2];
+
+    plane.min.x = stats.min[0];
+    plane.min.y = stats.min[1];
+    plane.min.z = stats.min[2];
+
+    plane.max.x = stats.max[0];
+    plane.max.y = stats.max[1];
+    plane.max.z = stats.max[2];
+
+    // Get plane polygon
+    plane.polygon.clear();
+    for (int i = 0; i < hull->points.size(); i++) {
+        geometry_msgs::Point32 p;
+        p.x = hull->points[i].x;
+        p.y = hull->points[i].y;
+        p.z = hull->points[i].z;
+
+        plane.polygon.push_back(p);
+    }
+
+    // Get plane coefficients
+    plane.coef[0] = coefficients.values[0];
+    plane.coef[1] = coefficients.values[1];
+    plane.coef[2] = coefficients.values[2];
+    plane.coef[3] = coefficients.values[3];
+
+    plane.orientation = getPlaneOrientation(coefficients);
+
+    plane.size.data = inliers->indices.size();
+}
+
+void PointCloudProcCore::fillPlanePayload(const CloudT::Ptr &cloud, const pcl::PointIndices::Ptr &inliers,
+                                          uint8_t payload, point_cloud_proc::Plane &plane) {
+
+    // Get cloud, the point data is only copied for the full payload
+    if (payload == point_cloud_proc::Plane::PAYLOAD_FULL) {
+        StageTimer timer(metrics_, "plane_packing", inliers->indices.size());
+        CloudT::Ptr cloud_plane = allocateCloud();
+        pcl::copyPointCloud(*cloud, *inliers, *cloud_plane);
+        pcl::toROSMsg(*cloud_plane, plane.cloud);
+    } else if (payload == point_cloud_proc::Plane::PAYLOAD_INDICES) {
+        plane.indices = inliers->indices;
+    }
+}
+
+uint8_t PointCloudProcCore::getPlaneOrientation(const pcl::ModelCoefficients &coefficients) {
+
+    if (std::abs(coefficients.values[0]) < 1.1 &&
+        std::abs(coefficients.values[0]) > 0.9 &&
+        std::abs(coefficients.values[1]) < 0.1 &&
+        std::abs(coefficients.values[2]) < 0.1) {
+        return point_cloud_proc::Plane::XAXIS;
+    } else if (std::abs(coefficients.values[0]) < 0.1 &&
+               std::abs(coefficients.values[1]) > 0.9 &&
+               std::abs(coefficients.values[1]) < 1.1 &&
+               std::abs(coefficients.values[2]) < 0.1) {
+        return point_cloud_proc::Plane::YAXIS;
+    } else if (std::abs(coefficients.values[0]) < 0.1 &&
+               std::abs(coefficients.values[1]) < 0.1 &&
+               std::abs(coefficients.values[2]) < 1.1 &&
+               std::abs(coefficients.values[2]) > 0.9) {
+        return point_cloud_proc::Plane::ZAXIS;
+    } else {
+        return point_cloud_proc::Plane::NOAXIS;
+    }
+}
+
+std::string PointCloudProcCore::getAxisName(uint8_t orientation) {
+    switch (orientation) {
+        case point_cloud_proc::Plane::XAXIS:
+            return "X";
+        case point_cloud_proc::Plane::YAXIS:
+            return "Y";
+        case point_cloud_proc::Plane::ZAXIS:
+            return "Z";
+        default:
+            return "NO";
+    }
+}
+
+bool PointCloudProcCore::extractTabletop() {
+
+    FramePtr frame = getFrame();
+    if (!frame) {
+        return false;
+    }
+
+    ObjectPool<WorkContext>::Handle context = contexts_.acquire();
+    std::lock_guard<std::mutex> lock(frame->mutex);
+    return extractFrameTabletop(*frame, *context);
+}
+
+bool PointCloudProcCore::extractFrameTabletop(Frame &frame, WorkContext &context) {
+
+    // The tabletop of the current plane was already extracted by a previous query
+    if (frame.tabletop) {
+        return true;
+    }
+
+    if (!frame.plane_hull) {
+        std::cout << "PCP: no plane was segmented in this frame!" << std::endl;
+        return false;
+    }
+
+    CloudT::Ptr cloud_filtered = frame.filtered;
+
+    StageTimer timer(metrics_, "prism", cloud_filtered->points.size());
+    pcl::PointIndices::Ptr tabletop_indices = allocateIndices();
+    context.prism.setHeightLimits(prism_limits_[0], prism_limits_[1]);
+    context.prism.segment(*cloud_filtered, *frame.plane_hull, *tabletop_indices);
+
+    CloudT::Ptr cloud_tabletop = allocateCloud();
+    context.extract.setInputCloud(cloud_filtered);
+    context.extract.setIndices(tabletop_indices);
+    context.extract.filter(*cloud_tabletop);
+    timer.setPointsOut(cloud_tabletop->points.size());
+
+    if (cloud_tabletop->points.size() == 0) {
+        return false;
+    } else {
+        // Search structure shared by all the tabletop processing of this frame
+        pcl::search::KdTree<PointT>::Ptr tabletop_tree(new pcl::search::KdTree<PointT>);
+        tabletop_tree->setInputCloud(cloud_tabletop);
+
+        frame.tabletop = cloud_tabletop;
+        frame.tabletop_tree = tabletop_tree;
+        frame.tabletop_indicies = tabletop_indices;
+
+        if (debug_) {
+            publishTabletopCloud(*cloud_tabletop);
+        }
+        return true;
+    }
+}
+
+bool PointCloudProcCore::getTabletop(CloudT::Ptr &cloud, pcl::search::KdTree<PointT>::Ptr &tree) {
+
+    FramePtr frame = getCurrentFrame();
+    if (!frame) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(frame->mutex);
+    cloud = frame->tabletop;
+    tree = frame->tabletop_tree;
+    return static_cast<bool>(cloud);
+}
+
+bool PointCloudProcCore::clusterObjects(std::vector<point_cloud_proc::Object> &objects,
+                                    bool compute_normals, bool project, uint8_t payload) {
+
+    geometry_msgs::PoseArray object_poses_rviz;
+    std::cout << "PCP: clustering tabletop objects... " << std::endl;
+
+    FramePtr frame = getFrame();
+    if (!frame) {
+        std::cout << "PCP: couldn't transform point cloud!" << std::endl;
+        return false;
+    }
+
+    ObjectPool<WorkContext>::Handle context = contexts_.acquire();
+    Eigen::Vector4f plane_coef;
+    CloudT::Ptr cloud_tabletop;
+    pcl::search::KdTree<PointT>::Ptr tabletop_tree;
+    std::shared_ptr<const std::vector<pcl::PointIndices> > clusters;
+    {
+        std::lock_guard<std::mutex> lock(frame->mutex);
+
+        // Only the plane coefficients and hull are needed here
+        if (!segmentFramePlane(*frame, *context, 'z')) {
+            std::cout << "PCP: failed to segment single plane" << std::endl;
+            return false;
+        }
+
+        if (!extractFrameTabletop(*frame, *context)) {
+            std::cout << "PCP: failed to extract tabletop" << std::endl;
+            return false;
+        }
+
+        if (!frame->clusters) {
+            std::shared_ptr<std::vector<pcl::PointIndices> > cloud_clusters(new std::vector<pcl::PointIndices>);
+            extractClusters(frame->tabletop, frame->tabletop_tree, *cloud_clusters);
+            frame->clusters = cloud_clusters;
+        }
+
+        const point_cloud_proc::Plane &plane = frame->plane_msg;
+        plane_coef = Eigen::Vector4f(plane.coef[0], plane.coef[1], plane.coef[2], plane.coef[3]);
+        cloud_tabletop = frame->tabletop;
+        tabletop_tree = frame->tabletop_tree;
+        clusters = frame->clusters;
+    }
+
+    if (clusters->size() == 0)
+        return false;
+    else
+        std::cout << "PCP: number of clusters: " << clusters->size() << std::endl;
+
+    // Object features only read the shared results, other queries of the frame can go on
+    std::vector<point_cloud_proc::Object> cluster_objects;
+    getObjectsFromClusters(cloud_tabletop, tabletop_tree, *clusters, plane_coef,
+                           compute_normals, payload, cluster_objects);
+
+    for (int k = 0; k < cluster_objects.size(); k++) {
+        std::cout << "PCP: # of points in object " << k + 1 << " : "
+                  << (*clusters)[k].indices.size() << std::endl;
+
+        object_poses_rviz.poses.push_back(cluster_objects[k].pose);
+        objects.push_back(cluster_objects[k]);
+    }
+
+    if (debug_) {
+        object_poses_rviz.header.frame_id = cloud_tabletop->header.frame_id;
+        publishObjectPoses(object_poses_rviz);
+    }
+    return true;
+}
+
+void PointCloudProcCore::extractClusters(const CloudT::Ptr &cloud, const pcl::search::KdTree<PointT>::Ptr &tree,
+                                     std::vector<pcl::PointIndices> &clusters) {
+
+    StageTimer timer(metrics_, "clustering", cloud->points.size());
+    clusters.clear();
+    if (cluster_mode_ == "voxel") {
+        // Pooled so the grid buffers are reused from one call to the next
+        ObjectPool<WorkContext>::Handle context = contexts_.acquire();
+        VoxelClustering &voxel_clustering = context->voxel_clustering;
+        voxel_clustering.setVoxelSize(cluster_tol_);
+        voxel_clustering.setMinClusterSize(min_cluster_size_);
+        voxel_clustering.setMaxClusterSize(max_cluster_size_);
+        voxel_clustering.extract(*cloud, clusters);
+    } else {
+        // EuclideanClusterExtraction always rebuilds its search tree, the free function
+        // uses the one built in extractTabletop() as is
+        pcl::extractEuclideanClusters<PointT>(*cloud, tree, cluster_tol_, clusters,
+                                              min_cluster_size_, max_cluster_size_);
+        std::sort(clusters.rbegin(), clusters.rend(), pcl::comparePointClusters);
+    }
+    timer.setPointsOut(clusters.size());
+}
+
+void PointCloudProcCore::getObjectsFromClusters(const CloudT::Ptr &cloud, const pcl::search::KdTree<PointT>::Ptr &tree,
+                                            const std::vector<pcl::PointIndices> &clusters,
+                                            const Eigen::Vector4f &plane_coef, bool compute_normals,
+                                            uint8_t payload, std::vector<point_cloud_proc::Object> &objects) {
+
+    StageTimer timer(metrics_, "object_features", clusters.size());
+
+    // Clusters are independent, results are stored by cluster index to keep the order
+    std::vector<point_cloud_proc::Object> cluster_objects(clusters.size());
+
+#pragma omp parallel for schedule(dynamic)
+    for (int c = 0; c < clusters.size(); c++) {
+        getObjectFromCluster(cloud, tree, clusters[c], plane_coef, compute_normals, payload, cluster_objects[c]);
+    }
+
+    objects.insert(objects.end(), cluster_objects.begin(), cluster_objects.end());
+    timer.setPointsOut(cluster_objects.size());
+}
+
+void PointCloudProcCore::getObjectFromCluster(const CloudT::Ptr &cloud, const pcl::search::KdTree<PointT>::Ptr &tree,
+                                          const pcl::PointIndices &cluster_indicies,
+                                          const Eigen::Vector4f &plane_coef, bool compute_normals,
+                                          uint8_t payload, point_cloud_proc::Object &object) {
+
+    CloudNT::Ptr cluster_normals;
+
+    // PAYLOAD_NONE leaves out all per point data, normals included
+    compute_normals = compute_normals && payload != point_cloud_proc::Object::PAYLOAD_NONE;
+
+    if (compute_normals) {
+        cluster_normals = allocateNormals();
+        pcl::PointIndices::Ptr object_indicies_ptr = allocateIndices();
+        object_indicies_ptr->indices = cluster_indicies.indices;
+
+        // Compute point normals against the whole tabletop cloud so the shared
+        // search tree built in extractTabletop() is reused
+        pcl::NormalEstimation<PointT, PointNT> ne;
+        ne.setInputCloud(cloud);
+        ne.setIndices(object_indicies_ptr);
+        ne.setSearchMethod(tree);
+        ne.setKSearch(k_search_);
+        ne.compute(*cluster_normals);
+    }
+
+    // Find position, bounds and covariance in one pass
+    ClusterStats stats;
+    bool has_points = computeClusterStats(*cloud, cluster_indicies.indices, stats);
+
+    // Find orientation and extents from the points projected on the table,
+    // without a valid plane the axis aligned bounds are used
+    OrientedBox box;
+    if (!estimateOrientedBox(*cloud, cluster_indicies.indices, plane_coef, stats, box)) {
+        if (!has_points) {
+            stats.centroid.setZero();
+            stats.min.setZero();
+            stats.max.setZero();
+        }
+        box.center = 0.5f * (stats.min + stats.max);
+        box.orientation.setIdentity();
+        box.dimensions = stats.max - stats.min;
+        box.major_min = stats.min;
+        box.major_max = stats.max;
+    }
+
+    // Get object point cloud
+    pcl_conversions::fromPCL(cloud->header, object.header);
+
+    // Get cloud, the point data is only copied for the full payload
+    StageTimer timer(metrics_, "object_packing", cluster_indicies.indices.size());
+    if (payload == point_cloud_proc::Object::PAYLOAD_FULL) {
+        CloudT::Ptr cluster = allocateCloud();
+        pcl::copyPointCloud(*cloud, cluster_indicies.indices, *cluster);
+        pcl::toROSMsg(*cluster, object.cloud);
+    } else if (payload == point_cloud_proc::Object::PAYLOAD_INDICES) {
+        object.indices = cluster_indicies.indices;
+    }
+
+    if (compute_normals && payload != point_cloud_proc::Object::PAYLOAD_FULL) {
+        // Get point normals as one flat array
+        object.packed_normals.resize(3 * cluster_normals->points.size());
+        for (int i = 0; i < cluster_normals->points.size(); i++) {
+            object.packed_normals[3 * i] = cluster_normals->points[i].normal_x;
+            object.packed_normals[3 * i + 1] = cluster_normals->points[i].normal_y;
+            object.packed_normals[3 * i + 2] = cluster_normals->points[i].normal_z;
+        }
+    } else if (compute_normals) {
+        // Get point normals
+        object.normals.reserve(cluster_normals->points.size());
+        for (int i = 0; i < cluster_normals->points.size(); i++) {
+            geometry_msgs::Vector3 normal;
+            normal.x = cluster_normals->points[i].normal_x;
+            normal.y = cluster_normals->points[i].normal_y;
+            normal.z = cluster_normals->points[i].normal_z;
+            object.normals.push_back(normal);
+        }
+    }
+
+
+    object.pmin.x = box.major_min[0];
+    object.pmin.y = box.major_min[1];
+    object.pmin.z = box.major_min[2];
+
+    object.pmax.x = box.major_max[0];
+    object.pmax.y = box.major_max[1];
+    object.pmax.z = box.major_max[2];
+
+    object.dimensions.x = box.dimensions[0];
+    object.dimensions.y = box.dimensions[1];
+    object.dimensions.z = box.dimensions[2];
+
+    // Get object center
+    object.center.x = stats.centroid[0];
+    object.center.y = stats.centroid[1];
+    object.center.z = stats.centroid[2];
+
+    // Pose of the oriented box
+    object.pose.position.x = box.center[0];
+    object.pose.position.y = box.center[1];
+    object.pose.position.z = box.center[2];
+
+    object.pose.orientation.x = box.orientation.x();
+    object.pose.orientation.y = box.orientation.y();
+    object.pose.orientation.z = box.orientation.z();
+    object.pose.orientation.w = box.orientation.w();
+
+    // Get min max points coords
+    object.min.x = stats.min[0];
+    object.min.y = stats.min[1];
+    object.min.z = stats.min[2];
+    object.max.x = stats.max[0];
+    object.max.y = stats.max[1];
+    object.max.z = stats.max[2];
+}
+
+bool PointCloudProcCore::projectPointCloudToPlane(sensor_msgs::PointCloud2 &cloud_in,
+                                              sensor_msgs::PointCloud2 &cloud_out,
+                                              pcl::ModelCoefficientsPtr plane_coeffs) {
+
+    CloudT::Ptr cloud_in_pcl = allocateCloud();
+    CloudT::Ptr cloud_out_pcl = allocateCloud();
+    pcl::fromROSMsg(cloud_in, *cloud_in_pcl);
+
+    ObjectPool<WorkContext>::Handle context = contexts_.acquire();
+    context->plane_proj.setModelType(pcl::SACMODEL_PLANE);
+    context->plane_proj.setModelCoefficients(plane_coeffs);
+    context->plane_proj.setInputCloud(cloud_in_pcl);
+    context->plane_proj.filter(*cloud_out_pcl);
+
+    pcl::toROSMsg(*cloud_out_pcl, cloud_out);
+
+    return true;
+}
+
+bool PointCloudProcCore::get3DPoint(int col, int row, geometry_msgs::PointStamped &point) {
+
+    FramePtr frame = getFrame();
+    if (!frame) {
+        std::cout << "PCP: couldn't get point cloud!" << std::endl;
+        return false;
+    }
+
+    if (col < 0 || col >= static_cast<int>(frame->input->width) ||
+        row < 0 || row >= static_cast<int>(frame->input->height)) {
+        std::cout << "PCP: pixel is outside of the image!" << std::endl;
+        return false;
+    }
+
+    CloudT pixel;
+    if (!getInputPoints(*frame, std::vector<int>(1, row * frame->input->width + col), pixel)) {
+        return false;
+    }
+
+    pcl_conversions::fromPCL(pixel.header, point.header);
+
+    if (!pixel.empty()) {
+        point.point.x = pixel.points[0].x;
+        point.point.y = pixel.points[0].y;
+        point.point.z = pixel.points[0].z;
+        return true;
+    } else {
+        std::cout << "PCP: The 3D point is not valid!" << std::endl;
+        return false;
+    }
+
+}
+
+bool PointCloudProcCore::getObjectFromBBox(int *bbox, point_cloud_proc::Object &object) {
+
+    FramePtr frame = getFrame();
+    if (!frame) {
+        std::cout << "PCP: couldn't get point cloud!" << std::endl;
+        return false;
+    }
+
+    // Pixels outside of the image are left out instead of wrapping to the next row
+    const int width = frame->input->width, height = frame->input->height;
+    pcl::PointIndices::Ptr bbox_indices = allocateIndices();
+    for (int i = std::max(bbox[0], 0); i < std::min(bbox[2], width); i++) {
+        for (int j = std::max(bbox[1], 0); j < std::min(bbox[3], height); j++) {
+            // Same pixel as at(i, j)
+            bbox_indices->indices.push_back(j * frame->input->width + i);
+        }
+    }
+
+    CloudT::Ptr object_cloud = allocateCloud();
+    CloudT::Ptr object_cloud_filtered = allocateCloud();
+    if (!getInputPoints(*frame, bbox_indices->indices, *object_cloud)) {
+        return false;
+    }
+
+    pcl_conversions::fromPCL(object_cloud->header, object.header);
+
+    removeOutliers(object_cloud, object_cloud_filtered);
+    if (object_cloud_filtered->empty()) {
+        std::cout << "PCP: object cloud is empty after removing outliers!" << std::endl;
+        return false;
+    }
+
+    ClusterStats stats;
+    computeClusterStats(*object_cloud_filtered, stats);
+
+    object.min.x = stats.min[0];
+    object.min.y = stats.min[1];
+    object.min.z = stats.min[2];
+    object.max.x = stats.max[0];
+    object.max.y = stats.max[1];
+    object.max.z = stats.max[2];
+
+    object.center.x = stats.centroid[0];
+    object.center.y = stats.centroid[1];
+    object.center.z = stats.centroid[2];
+
+    if (debug_) {
+        publishObjectCloud(*object_cloud_filtered);
+    }
+    return true;
+
+}
+
+bool PointCloudProcCore::getObjectFromContour(const std::vector<int> &contour_x, const std::vector<int> &contour_y,
+                                          point_cloud_proc::Object &object) {
+
+    FramePtr frame = getFrame();
+    if (!frame) {
+        std::cout << "PCP: couldn't get point cloud!" << std::endl;
+        return false;
+    }
+
+    std::cout << "PCP: getting object cluster from contours..." << std::endl;
+
+    pcl::PointIndices::Ptr contour_indices = allocateIndices();
+    const int width = frame->input->width, height = frame->input->height;
+    const int contour_size = static_cast<int>(std::min(contour_x.size(), contour_y.size()));
+    contour_indices->indices.reserve(contour_size);
+    for (int i = 0; i < contour_size; i++){
+        // Same pixel as at(contour_y[i], contour_x[i]), pixels outside of the image are left out
+        if (contour_y[i] < 0 || contour_y[i] >= width || contour_x[i] < 0 || contour_x[i] >= height) {
+            continue;
+        }
+        contour_indices->indices.push_back(contour_x[i] * width + contour_y[i]);
+    }
+
+    CloudT::Ptr object_cloud = allocateCloud();
+    if (!getInputPoints(*frame, contour_indices->indices, *object_cloud)) {
+        return false;
+    }
+
+    pcl_conversions::fromPCL(object_cloud->header, object.header);
+
+    ClusterStats stats;
+    if (!computeClusterStats(*object_cloud, stats)) {
+        std::cout << "PCP: object cloud is empty!" << std::endl;
+        return false;
+    }
+
+    object.min.x = stats.min[0];
+    object.min.y = stats.min[1];
+    object.min.z = stats.min[2];
+    object.max.x = stats.max[0];
+    object.max.y = stats.max[1];
+    object.max.z = stats.max[2];
+
+    object.center.x = stats.centroid[0];
+    object.center.y = stats.centroid[1];
+    object.center.z = stats.centroid[2];
+
+    if (debug_) {
+        publishObjectCloud(*object_cloud);
+    }
+    return true;
+}
+
+bool PointCloudProcCore::generatePoissonMesh(sensor_msgs::PointCloud2 &ros_cloud, pcl::PolygonMesh &mesh) {
+    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_smoothed(new pcl::PointCloud<pcl::PointXYZ>());
+    pcl::fromROSMsg(ros_cloud, *cloud_smoothed);
+
+/*    pcl::MovingLeastSquares<pcl::PointXYZ, pcl::PointXYZ> mls;
+    mls.setInputCloud(cloud);
+    mls.setSearchRadius(0.01);
+    mls.setPolynomialFit(true);
+    mls.setPolynomialOrder(2);
+    mls.setUpsamplingMethod(pcl::MovingLeastSquares<pcl::PointXYZ, pcl::PointXYZ>::SAMPLE_LOCAL_PLANE);
+    mls.setUpsamplingRadius(0.005);
+    mls.setUpsamplingStepSize(0.003);
+
+    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_smoothed(new pcl::PointCloud<pcl::PointXYZ> ());
+    mls.process(*cloud_smoothed);*/
+
+    pcl::NormalEstimationOMP<pcl::PointXYZ, pcl::Normal> ne;
+    ne.setNumberOfThreads(8);
+    ne.setInputCloud(cloud_smoothed);
+    ne.setRadiusSearch(0.01);
+    Eigen::Vector4f centroid;
+    compute3DCentroid(*cloud_smoothed, centroid);
+    ne.setViewPoint(centroid[0], centroid[1], centroid[2]);
+
+    pcl::PointCloud<pcl::Normal>::Ptr cloud_normals(new pcl::PointCloud<pcl::Normal> ());
+    ne.compute(*cloud_normals);
+
+    for (size_t i = 0; i < cloud_normals->size (); ++i)
+    {
+      cloud_normals->points[i].normal_x *= -1;
+      cloud_normals->points[i].normal_y *= -1;
+      cloud_normals->points[i].normal_z *= -1;
+    }
+
+    std::cout << "PCP: Cloud normals calculated ";
+
+    pcl::PointCloud<pcl::PointNormal>::Ptr cloud_smoothed_normals(new pcl::PointCloud<pcl::PointNormal> ());
+    concatenateFields(*cloud_smoothed, *cloud_normals, *cloud_smoothed_normals);
+
+    pcl::Poisson<pcl::PointNormal> poisson;
+    poisson.setDepth(7);
+    poisson.setInputCloud(cloud_smoothed_normals);
+    //PolygonMesh mesh;
+    poisson.reconstruct(mesh);
+
+    std::cout << "PCP: poission mesh constructed";
+}
+
+bool PointCloudProcCore::generateMeshFromPointCloud(sensor_msgs::PointCloud2 &cloud, pcl_msgs::PolygonMesh &mesh, pcl::PolygonMesh &pcl_mesh) {
+
+    pcl::NormalEstimationOMP<pcl::PointXYZ, PointNT> ne(6);
+    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_in(new pcl::PointCloud<pcl::PointXYZ>);
+    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_in_filtered(new pcl::PointCloud<pcl::PointXYZ>);
+
+    pcl::search::KdTree<pcl::PointXYZ>::Ptr tree1(new pcl::search::KdTree<pcl::PointXYZ>());
+    pcl::search::KdTree<pcl::PointNormal>::Ptr tree2 (new pcl::search::KdTree<pcl::PointNormal>);
+
+
+    pcl::PointCloud<pcl::Normal>::Ptr normals(new pcl::PointCloud<pcl::Normal>);
+    pcl::PointCloud<pcl::PointNormal>::Ptr cloud_normals(new pcl::PointCloud<pcl::PointNormal>);
+
+    pcl::fromROSMsg(cloud, *cloud_in);
+
+    if (debug_) {
+        pcl::io::savePCDFileASCII ("test_pcd.pcd", *cloud_in);
+    }
+
+    std::vector<int> indicies;
+    pcl::removeNaNFromPointCloud(*cloud_in, *cloud_in, indicies);
+
+//    pcl::VoxelGrid<pcl::PointXYZ> vg;
+//    vg.setInputCloud(cloud_in);
+//    vg.setLeafSize (0.03f, 0.03f, 0.03f);
+//    vg.filter(*cloud_in_filtered);
+
+
+    tree1->setInputCloud(cloud_in);
+    ne.setInputCloud(cloud_in);
+    ne.setSearchMethod(tree1);
+    ne.setKSearch(40);
+//    ne.setRadiusSearch(0.01);
+    ne.compute(*normals);
+
+    pcl::concatenateFields(*cloud_in, *normals, *cloud_normals);
+
+//    for(size_t i = 0; i < cloud_normals->size(); ++i){
+//        cloud_normals->points[i].normal_x *= -1;
+//        cloud_normals->points[i].normal_y *= -1;
+//        cloud_normals->points[i].normal_z *= -1;
+//    }
+
+
+    //pcl::PolygonMesh pcl_mesh;
+    pcl::Poisson<pcl::PointNormal> ps;
+    tree2->setInputCloud(cloud_normals);
+    ps.setDepth (8);
+    ps.setSolverDivide (8);
+    ps.setIsoDivide (8);
+    ps.setPointWeight (4.0f);
+    ps.setInputCloud(cloud_normals);
+    ps.setSearchMethod(tree2);
+    ps.reconstruct(pcl_mesh);
+
+    pcl_conversions::fromPCL(pcl_mesh, mesh);
+
+    std::cout << "PCP: # of triangles : " << pcl_mesh.polygons.size() << std::endl;
+
+    return true;
+
+}
+
+bool PointCloudProcCore::trianglePointCloud(sensor_msgs::PointCloud2 &cloud, pcl_msgs::PolygonMesh &mesh, pcl::PolygonMesh &triangles) {
+
+    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_xyz(new pcl::PointCloud<pcl::PointXYZ>);
+    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_xyz_(new pcl::PointCloud<pcl::PointXYZ>);
+//  pcl::copyPointCloud(*cloud, *cloud_xyz);
+    pcl::fromROSMsg(cloud, *cloud_xyz);
+/*    pcl::VoxelGrid<pcl::PointXYZ> vg;
+    vg.setInputCloud(cloud_xyz_);
+    //vg.setLeafSize (0.01f, 0.01f, 0.01f);
+    vg.setLeafSize(0.0005f, 0.0005f, 0.0f);
+    vg.filter(*cloud_xyz);*/
+
+    // Compute point normals
+    pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> ne;
+    pcl::PointCloud<pcl::Normal>::Ptr normals(new pcl::PointCloud<pcl::Normal>);
+    pcl::PointCloud<pcl::PointNormal>::Ptr cloud_normals(new pcl::PointCloud<pcl::PointNormal>);
+    pcl::search::KdTree<pcl::PointXYZ>::Ptr tree(new pcl::search::KdTree<pcl::PointXYZ>());
+
+    tree->setInputCloud(cloud_xyz);
+    ne.setInputCloud(cloud_xyz);
+    ne.setSearchMethod(tree);
+    ne.setKSearch(20);
+    ne.compute(*normals);
+
+    pcl::concatenateFields(*cloud_xyz, *normals, *cloud_normals);
+
+    pcl::search::KdTree<pcl::PointNormal>::Ptr tree2(new pcl::search::KdTree<pcl::PointNormal>);
+    tree2->setInputCloud(cloud_normals);
+
+//  pcl::PolygonMesh triangles;
+    //pcl::PolygonMesh::Ptr triangles(new pcl::PolygonMesh());
+    ObjectPool<WorkContext>::Handle context = contexts_.acquire();
+    pcl::GreedyProjectionTriangulation<pcl::PointNormal> &gp3 = context->gp3;
+    gp3.setSearchRadius(0.75);
+    gp3.setMu(3.5);
+    gp3.setMaximumNearestNeighbors(200);
+    gp3.setMaximumSurfaceAngle(M_PI / 4); // 45 degrees
+    gp3.setMinimumAngle(M_PI / 18); // 10 degrees
+    gp3.setMaximumAngle(2 * M_PI / 3); // 120 degrees
+    gp3.setNormalConsistency(false);
+
+    gp3.setInputCloud(cloud_normals);
+    gp3.setSearchMethod(tree2);
+    gp3.reconstruct(triangles);
+
+
+    pcl_conversions::fromPCL(triangles, mesh);
+
+
+//  pcl::PointCloud<pcl::PointXYZ> triangle_cloud;
+//  pcl::fromPCLPointCloud2(triangles.cloud, triangle_cloud);
+//  int i = 0;
+//  mesh.vertices.resize(t)
+//  for(auto point : triangle_cloud.points){
+//    geometry_msgs::Point p;
+//    p.x = point.x;
+//    p.y = point.y;
+//    p.z = point.z;
+//
+//    mesh.vertices.push_back(p);
+//    triangles.polygons[i]
+//  }
+
+
+    return true;
+}
+
+bool PointCloudProcCore::trianglePointCloud_greedy(sensor_msgs::PointCloud2 &ros_cloud, pcl_msgs::PolygonMesh &mesh, pcl::PolygonMesh &triangles) {
+
+    // Load input file into a PointCloud<T> with an appropriate type
+    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud (new pcl::PointCloud<pcl::PointXYZ>);
+    pcl::fromROSMsg(ros_cloud, *cloud);
+
+    std::vector<int> indicies;
+    pcl::removeNaNFromPointCloud(*cloud, *cloud, indicies);
+    //* the data should be available in cloud
+
+    // Normal estimation*
+    pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> n;
+    pcl::PointCloud<pcl::Normal>::Ptr normals (new pcl::PointCloud<pcl::Normal>);
+    pcl::search::KdTree<pcl::PointXYZ>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZ>);
+    tree->setInputCloud (cloud);
+    n.setInputCloud (cloud);
+    n.setSearchMethod (tree);
+    n.setKSearch (20);
+    n.compute (*normals);
+    //* normals should not contain the point normals + surface curvatures
+
+    // Concatenate the XYZ and normal fields*
+    pcl::PointCloud<pcl::PointNormal>::Ptr cloud_with_normals (new pcl::PointCloud<pcl::PointNormal>);
+    pcl::concatenateFields (*cloud, *normals, *cloud_with_normals);
+    //* cloud_with_normals = cloud + normals
+
+    // Create search tree*
+    pcl::search::KdTree<pcl::PointNormal>::Ptr tree2 (new pcl::search::KdTree<pcl::PointNormal>);
+    tree2->setInputCloud (cloud_with_normals);
+
+    // Initialize objects
+    pcl::GreedyProjectionTriangulation<pcl::PointNormal> gp3;
+    //pcl::PolygonMesh triangles;
+
+    // Set the maximum distance between connected points (maximum edge length)
+    gp3.setSearchRadius (0.025); //0.025
+
+    // Set typical values for the parameters
+    gp3.setMu (2.5); //2.5
+    gp3.setMaximumNearestNeighbors (500); //100
+    gp3.setMaximumSurfaceAngle(M_PI/4); // 45 degrees
+    gp3.setMinimumAngle(M_PI/18); // 10 degrees
+    gp3.setMaximumAngle(2*M_PI/3); // 120 degrees
+    gp3.setNormalConsistency(false);
+
+    // Get result
+    gp3.setInputCloud (cloud_with_normals);
+    gp3.setSearchMethod (tree2);
+    gp3.reconstruct (triangles);
+
+    // Additional vertex information
+    std::vector<int> parts = gp3.getPartIDs();
+    std::vector<int> states = gp3.getPointStates();
+
+
+    return true;
+}
+
+void PointCloudProcCore::getRemainingCloud(sensor_msgs::PointCloud2 &cloud) {
+
+    FramePtr frame = getCurrentFrame();
+    CloudT::Ptr remaining_cloud;
+    pcl::PointIndices::Ptr remaining_indices;
+    if (frame) {
+        std::lock_guard<std::mutex> lock(frame->mutex);
+        remaining_cloud = frame->remaining_cloud;
+        remaining_indices = frame->remaining_indices;
+    }
+
+    // Before the multiple planes are segmented nothing is removed yet
+    if (!remaining_cloud) {
+        pcl::toROSMsg(*getFilteredCloud(), cloud);
+        return;
+    }
+
+    CloudT::Ptr remaining = allocateFrameCloud();
+    pcl::copyPointCloud(*remaining_cloud, *remaining_indices, *remaining);
+    pcl::toROSMsg(*remaining, cloud);
+}
+
+void PointCloudProcCore::getFilteredCloud(sensor_msgs::PointCloud2 &cloud) {
+
+    // Filtered and read on the same frame, even when another thread replaces it
+    FramePtr frame = getFrame();
+    CloudT::Ptr cloud_filtered;
+    if (frame) {
+        ObjectPool<WorkContext>::Handle context = contexts_.acquire();
+        std::lock_guard<std::mutex> lock(frame->mutex);
+        if (filterFrame(*frame, *context)) {
+            cloud_filtered = frame->filtered;
+        }
+    }
+
+    if (!cloud_filtered) {
+        std::cout << "PCP: couldn't filter point cloud!" << std::endl;
+        cloud_filtered = allocateCloud();
+    }
+    pcl::toROSMsg(*cloud_filtered, cloud);
+}
+
+sensor_msgs::PointCloud2::Ptr PointCloudProcCore::getTabletopCloud() {
+    sensor_msgs::PointCloud2::Ptr cloud(new sensor_msgs::PointCloud2);
+
+    CloudT::Ptr cloud_tabletop;
+    pcl::search::KdTree<PointT>::Ptr tabletop_tree;
+    if (getTabletop(cloud_tabletop, tabletop_tree)) {
+        pcl::toROSMsg(*cloud_tabletop, *cloud);
+    }
+
+    return cloud;
+}
+
+void PointCloudProcCore::getPlaneFrameCloud(sensor_msgs::PointCloud2 &cloud) {
+
+    FramePtr frame = getCurrentFrame();
+    if (!frame) {
+        return;
+    }
+
+    CloudT::Ptr plane_frame_cloud;
+    {
+        std::lock_guard<std::mutex> lock(frame->mutex);
+        plane_frame_cloud = frame->plane_frame_cloud;
+    }
+
+    if (plane_frame_cloud) {
+        pcl::toROSMsg(*plane_frame_cloud, cloud);
+    }
+}
+
+PointCloudProcCore::CloudT::Ptr PointCloudProcCore::getFilteredCloud() {
+
+    FramePtr frame = getCurrentFrame();
+    if (frame) {
+        std::lock_guard<std::mutex> lock(frame->mutex);
+        if (frame->filtered) {
+            return frame->filtered;
+        }
+    }
+
+    return allocateCloud();
+}
+
+pcl::PointIndices::Ptr PointCloudProcCore::getTabletopIndicies() {
+
+    FramePtr frame = getCurrentFrame();
+    if (!frame) {
+        return pcl::PointIndices::Ptr();
+    }
+
+    std::lock_guard<std::mutex> lock(frame->mutex);
+    return frame->tabletop_indicies;
+}
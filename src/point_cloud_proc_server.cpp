@@ -0,0 +1,110 @@
+#include <ros/ros.h>
+#include <point_cloud_proc/point_cloud_proc.h>
+
+// Serves the point_cloud_proc services from a single subscription. Queries
+// about the same frame reuse the transformed, filtered and segmented results
+// cached by PointCloudProc instead of processing the frame again. Calls are
+// served concurrently by the spinner threads.
+class PointCloudProcServer {
+public:
+    PointCloudProcServer(ros::NodeHandle nh, ros::NodeHandle pnh, bool debug, bool streaming,
+                         std::string config) :
+            pcp_(nh, debug, config) {
+
+        pnh.param("compute_normals", compute_normals_, false);
+
+        // Planes and objects of every frame are published instead of serving requests
+        if (streaming) {
+            pcp_.startStreaming();
+            return;
+        }
+
+        single_plane_srv_ = nh.advertiseService("segment_single_plane",
+                                                &PointCloudProcServer::segmentSinglePlane, this);
+        multi_plane_srv_ = nh.advertiseService("segment_multi_plane",
+                                               &PointCloudProcServer::segmentMultiplePlane, this);
+        tabletop_srv_ = nh.advertiseService("extract_tabletop",
+                                            &PointCloudProcServer::extractTabletop, this);
+        clustering_srv_ = nh.advertiseService("cluster_objects",
+                                              &PointCloudProcServer::clusterObjects, this);
+    }
+
+    bool segmentSinglePlane(point_cloud_proc::SinglePlaneSegmentation::Request &req,
+                            point_cloud_proc::SinglePlaneSegmentation::Response &res) {
+        // The frame cloud has to be the one the indices refer to
+        res.success = pcp_.beginFrame() &&
+                      pcp_.segmentSinglePlane(res.plane_object, 'z', req.payload);
+        if (res.success && req.payload == point_cloud_proc::Plane::PAYLOAD_INDICES) {
+            pcp_.getPlaneFrameCloud(res.frame_cloud);
+        }
+        pcp_.endFrame();
+        return true;
+    }
+
+    bool segmentMultiplePlane(point_cloud_proc::MultiPlaneSegmentation::Request &req,
+                              point_cloud_proc::MultiPlaneSegmentation::Response &res) {
+        res.success = pcp_.beginFrame() &&
+                      pcp_.segmentMultiplePlane(res.planes, PointCloudProc::PlaneCallback(), req.payload);
+        if (res.success && req.payload == point_cloud_proc::Plane::PAYLOAD_INDICES) {
+            pcp_.getPlaneFrameCloud(res.frame_cloud);
+        }
+        pcp_.endFrame();
+        return true;
+    }
+
+    bool extractTabletop(point_cloud_proc::TabletopExtraction::Request &req,
+                         point_cloud_proc::TabletopExtraction::Response &res) {
+        // The plane and the tabletop of one frame
+        point_cloud_proc::Plane plane;
+        res.success = pcp_.beginFrame() &&
+                      pcp_.segmentSinglePlane(plane, 'z', point_cloud_proc::Plane::PAYLOAD_NONE) &&
+                      pcp_.extractTabletop();
+        if (res.success) {
+            res.object_cluster = *pcp_.getTabletopCloud();
+        }
+        pcp_.endFrame();
+        return true;
+    }
+
+    bool clusterObjects(point_cloud_proc::TabletopClustering::Request &req,
+                        point_cloud_proc::TabletopClustering::Response &res) {
+        res.success = pcp_.beginFrame() &&
+                      pcp_.clusterObjects(res.objects, compute_normals_, false, req.payload);
+        if (res.success && req.payload == point_cloud_proc::Object::PAYLOAD_INDICES) {
+            res.frame_cloud = *pcp_.getTabletopCloud();
+        }
+        pcp_.endFrame();
+        return true;
+    }
+
+private:
+    PointCloudProc pcp_;
+    bool compute_normals_;
+
+    ros::ServiceServer single_plane_srv_, multi_plane_srv_, tabletop_srv_, clustering_srv_;
+};
+
+
+int main(int argc, char **argv) {
+
+    ros::init(argc, argv, "point_cloud_proc_server");
+    ros::NodeHandle nh;
+    ros::NodeHandle pnh("~");
+
+    bool debug, streaming;
+    std::string config;
+    int threads;
+    pnh.param("debug", debug, false);
+    pnh.param("streaming", streaming, false);
+    pnh.param("config", config, std::string(""));
+    pnh.param("threads", threads, 4);
+
+    PointCloudProcServer server(nh, pnh, debug, streaming, config);
+
+    // Clouds keep arriving while a service call waits for its frame
+    ros::AsyncSpinner spinner(threads);
+    spinner.start();
+    ros::waitForShutdown();
+
+    return 0;
+}
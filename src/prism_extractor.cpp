@@ -0,0 +1,222 @@
+#include <point_cloud_proc/prism_extractor.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <Eigen/Eigenvalues>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+PolygonalPrismExtractor::PolygonalPrismExtractor() :
+        height_min_(-FLT_MAX), height_max_(FLT_MAX), plane_(Eigen::Vector4f::Zero()), k1_(0), k2_(1),
+        convex_(false), min_u_(0.0f), max_u_(0.0f), min_v_(0.0f), max_v_(0.0f) {
+}
+
+void PolygonalPrismExtractor::setHeightLimits(float height_min, float height_max) {
+    height_min_ = height_min;
+    height_max_ = height_max;
+}
+
+bool PolygonalPrismExtractor::setPolygon(const CloudT &polygon) {
+
+    const size_t size = polygon.points.size();
+    if (size < 3)
+        return false;
+
+    // Plane through the polygon vertices
+    Eigen::Vector3d mean = Eigen::Vector3d::Zero();
+    for (size_t i = 0; i < size; i++) {
+        mean += polygon.points[i].getVector3fMap().cast<double>();
+    }
+    mean /= static_cast<double>(size);
+
+    Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();
+    for (size_t i = 0; i < size; i++) {
+        Eigen::Vector3d d = polygon.points[i].getVector3fMap().cast<double>() - mean;
+        covariance += d * d.transpose();
+    }
+
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(covariance);
+    if (solver.info() != Eigen::Success)
+        return false;
+
+    Eigen::Vector3f normal = solver.eigenvectors().col(0).cast<float>();
+
+    // Normal points toward the viewpoint like pcl::ExtractPolygonalPrismData
+    const Eigen::Vector3f first = polygon.points[0].getVector3fMap();
+    if ((-first).dot(normal) < 0.0f) {
+        normal = -normal;
+        plane_ << normal, -normal.dot(first);
+    } else {
+        plane_ << normal, static_cast<float>(-normal.cast<double>().dot(mean));
+    }
+
+    // Keep the two coordinates the plane is least inclined to
+    int k0 = std::abs(normal[0]) > std::abs(normal[1]) ? 0 : 1;
+    k0 = std::abs(normal[k0]) > std::abs(normal[2]) ? k0 : 2;
+    k1_ = (k0 + 1) % 3;
+    k2_ = (k0 + 2) % 3;
+
+    polygon_u_.resize(size);
+    polygon_v_.resize(size);
+    min_u_ = min_v_ = FLT_MAX;
+    max_u_ = max_v_ = -FLT_MAX;
+    double area = 0.0;
+    for (size_t i = 0; i < size; i++) {
+        polygon_u_[i] = polygon.points[i].data[k1_];
+        polygon_v_[i] = polygon.points[i].data[k2_];
+        min_u_ = std::min(min_u_, polygon_u_[i]);
+        max_u_ = std::max(max_u_, polygon_u_[i]);
+        min_v_ = std::min(min_v_, polygon_v_[i]);
+        max_v_ = std::max(max_v_, polygon_v_[i]);
+    }
+    for (size_t i = 0; i < size; i++) {
+        size_t j = (i + 1) % size;
+        area += static_cast<double>(polygon_u_[i]) * polygon_v_[j] - static_cast<double>(polygon_u_[j]) * polygon_v_[i];
+    }
+    if (area == 0.0)
+        return false;
+
+    // Edge functions oriented so the inside is positive for both windings
+    const float winding = area > 0.0 ? 1.0f : -1.0f;
+    const float extent = std::max(max_u_ - min_u_, max_v_ - min_v_);
+    const float collinear = 1e-6f * extent * extent;
+
+    edge_a_.resize(size);
+    edge_b_.resize(size);
+    edge_c_.resize(size);
+    convex_ = true;
+    for (size_t i = 0; i < size; i++) {
+        size_t j = (i + 1) % size, k = (i + 2) % size;
+        float du = polygon_u_[j] - polygon_u_[i];
+        float dv = polygon_v_[j] - polygon_v_[i];
+        edge_a_[i] = -winding * dv;
+        edge_b_[i] = winding * du;
+        edge_c_[i] = winding * (dv * polygon_u_[i] - du * polygon_v_[i]);
+
+        // Every turn has to go the same way as the winding
+        float turn = du * (polygon_v_[k] - polygon_v_[j]) - dv * (polygon_u_[k] - polygon_u_[j]);
+        if (winding * turn < -collinear)
+            convex_ = false;
+    }
+
+    return true;
+}
+
+bool PolygonalPrismExtractor::isInsidePolygon(float u, float v) const {
+
+    bool inside = false;
+    const size_t size = polygon_u_.size();
+    double u_old = polygon_u_[size - 1], v_old = polygon_v_[size - 1];
+    for (size_t i = 0; i < size; i++) {
+        double u_new = polygon_u_[i], v_new = polygon_v_[i];
+        double u1, u2, v1, v2;
+        if (u_new > u_old) {
+            u1 = u_old;
+            u2 = u_new;
+            v1 = v_old;
+            v2 = v_new;
+        } else {
+            u1 = u_new;
+            u2 = u_old;
+            v1 = v_new;
+            v2 = v_old;
+        }
+
+        if ((u_new < u) == (u <= u_old) && (v - v1) * (u2 - u1) < (v2 - v1) * (u - u1))
+            inside = !inside;
+
+        u_old = u_new;
+        v_old = v_new;
+    }
+    return inside;
+}
+
+bool PolygonalPrismExtractor::isInside(float x, float y, float z) const {
+
+    const float height = plane_[0] * x + plane_[1] * y + plane_[2] * z + plane_[3];
+    if (height < height_min_ || height > height_max_)
+        return false;
+
+    const float point[3] = {x, y, z};
+    const float u = point[k1_] - height * plane_[k1_];
+    const float v = point[k2_] - height * plane_[k2_];
+    if (u < min_u_ || u > max_u_ || v < min_v_ || v > max_v_)
+        return false;
+
+    if (!convex_)
+        return isInsidePolygon(u, v);
+
+    for (size_t e = 0; e < edge_a_.size(); e++) {
+        if (edge_a_[e] * u + edge_b_[e] * v + edge_c_[e] < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+bool PolygonalPrismExtractor::segment(const CloudT &cloud, const CloudT &polygon, pcl::PointIndices &inliers) {
+
+    inliers.header = cloud.header;
+    inliers.indices.clear();
+
+    if (!setPolygon(polygon))
+        return false;
+
+    points_.assign(cloud, std::vector<int>());
+    inliers.indices.reserve(points_.size());
+
+    const float *coordinates[3] = {points_.x().data(), points_.y().data(), points_.z().data()};
+    const std::vector<int> &source_indices = points_.sourceIndices();
+    const size_t n = points_.size();
+    size_t i = 0;
+
+#ifdef __SSE2__
+    if (convex_) {
+        const __m128 a = _mm_set1_ps(plane_[0]), b = _mm_set1_ps(plane_[1]);
+        const __m128 c = _mm_set1_ps(plane_[2]), d = _mm_set1_ps(plane_[3]);
+        const __m128 n1 = _mm_set1_ps(plane_[k1_]), n2 = _mm_set1_ps(plane_[k2_]);
+        const __m128 height_min = _mm_set1_ps(height_min_), height_max = _mm_set1_ps(height_max_);
+        const __m128 min_u = _mm_set1_ps(min_u_), max_u = _mm_set1_ps(max_u_);
+        const __m128 min_v = _mm_set1_ps(min_v_), max_v = _mm_set1_ps(max_v_);
+        const __m128 zero = _mm_setzero_ps();
+        const size_t simd_end = n & ~static_cast<size_t>(3);
+
+        for (; i < simd_end; i += 4) {
+            const __m128 height = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, _mm_load_ps(coordinates[0] + i)),
+                                                        _mm_mul_ps(b, _mm_load_ps(coordinates[1] + i))),
+                                             _mm_add_ps(_mm_mul_ps(c, _mm_load_ps(coordinates[2] + i)), d));
+            __m128 mask = _mm_and_ps(_mm_cmpge_ps(height, height_min), _mm_cmple_ps(height, height_max));
+            if (_mm_movemask_ps(mask) == 0)
+                continue;
+
+            // Projection on the plane, only the two kept coordinates are needed
+            const __m128 u = _mm_sub_ps(_mm_load_ps(coordinates[k1_] + i), _mm_mul_ps(height, n1));
+            const __m128 v = _mm_sub_ps(_mm_load_ps(coordinates[k2_] + i), _mm_mul_ps(height, n2));
+            mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(u, min_u), _mm_cmple_ps(u, max_u)));
+            mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(v, min_v), _mm_cmple_ps(v, max_v)));
+
+            for (size_t e = 0; e < edge_a_.size() && _mm_movemask_ps(mask) != 0; e++) {
+                const __m128 edge = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(edge_a_[e]), u),
+                                                          _mm_mul_ps(_mm_set1_ps(edge_b_[e]), v)),
+                                               _mm_set1_ps(edge_c_[e]));
+                mask = _mm_and_ps(mask, _mm_cmpge_ps(edge, zero));
+            }
+
+            int inside = _mm_movemask_ps(mask);
+            for (int lane = 0; inside != 0; lane++, inside >>= 1) {
+                if (inside & 1)
+                    inliers.indices.push_back(source_indices[i + lane]);
+            }
+        }
+    }
+#endif
+
+    for (; i < n; i++) {
+        if (isInside(coordinates[0][i], coordinates[1][i], coordinates[2][i]))
+            inliers.indices.push_back(source_indices[i]);
+    }
+
+    return true;
+}
@@ -0,0 +1,36 @@
+#include <point_cloud_proc/soa_cloud.h>
+
+void SoACloud::assign(const CloudT &cloud, const std::vector<int> &indices, bool colour) {
+
+    clear();
+
+    const size_t input_size = indices.empty() ? cloud.points.size() : indices.size();
+    x_.reserve(input_size);
+    y_.reserve(input_size);
+    z_.reserve(input_size);
+    source_indices_.reserve(input_size);
+    if (colour)
+        rgba_.reserve(input_size);
+
+    for (size_t i = 0; i < input_size; i++) {
+        int index = indices.empty() ? static_cast<int>(i) : indices[i];
+        const PointT &p = cloud.points[index];
+        if (!pcl::isFinite(p))
+            continue;
+
+        x_.push_back(p.x);
+        y_.push_back(p.y);
+        z_.push_back(p.z);
+        source_indices_.push_back(index);
+        if (colour)
+            rgba_.push_back(p.rgba);
+    }
+}
+
+void SoACloud::clear() {
+    x_.clear();
+    y_.clear();
+    z_.clear();
+    rgba_.clear();
+    source_indices_.clear();
+}
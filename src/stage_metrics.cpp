@@ -0,0 +1,117 @@
+#include <point_cloud_proc/stage_metrics.h>
+
+#include <algorithm>
+
+namespace {
+
+// Nearest rank percentile of sorted durations
+float percentile(const std::vector<float> &sorted, float p) {
+    int rank = static_cast<int>(p * sorted.size() + 0.5f) - 1;
+    rank = std::max(0, std::min(rank, static_cast<int>(sorted.size()) - 1));
+    return sorted[rank];
+}
+
+}
+
+StageMetrics::StageMetrics() :
+        enabled_(false), window_size_(100), origin_(Clock::now()) {
+}
+
+StageMetrics::~StageMetrics() {
+    closeTrace();
+}
+
+void StageMetrics::setWindowSize(int window_size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    window_size_ = std::max(1, window_size);
+    stages_.clear();
+}
+
+bool StageMetrics::openTrace(const std::string &path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (trace_.is_open())
+        trace_.close();
+
+    trace_.open(path.c_str(), std::ios::out | std::ios::trunc);
+    if (!trace_.is_open())
+        return false;
+
+    trace_ << "stage,start_us,duration_us,points_in,points_out\n";
+    return true;
+}
+
+void StageMetrics::closeTrace() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (trace_.is_open())
+        trace_.close();
+}
+
+void StageMetrics::record(const std::string &stage, Clock::time_point start, Clock::time_point end,
+                          size_t points_in, size_t points_out) {
+    if (!enabled_)
+        return;
+
+    float duration_ms = std::chrono::duration<float, std::milli>(end - start).count();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    StageWindow &window = stages_[stage];
+    if (window.durations.empty()) {
+        window.durations.reserve(window_size_);
+        window.next = 0;
+        window.count = 0;
+    }
+
+    // Ring buffer of the last window_size_ samples
+    if (window.durations.size() < window_size_) {
+        window.durations.push_back(duration_ms);
+    } else {
+        window.durations[window.next] = duration_ms;
+    }
+    window.next = (window.next + 1) % window_size_;
+    window.count++;
+    window.last_ms = duration_ms;
+    window.points_in = points_in;
+    window.points_out = points_out;
+
+    if (trace_.is_open()) {
+        trace_ << stage << ','
+               << std::chrono::duration_cast<std::chrono::microseconds>(start - origin_).count() << ','
+               << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << ','
+               << points_in << ',' << points_out << '\n';
+    }
+}
+
+void StageMetrics::getSummaries(std::vector<Summary> &summaries) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    summaries.clear();
+    summaries.reserve(stages_.size());
+
+    std::vector<float> sorted;
+    for (std::map<std::string, StageWindow>::const_iterator it = stages_.begin(); it != stages_.end(); ++it) {
+        const StageWindow &window = it->second;
+
+        sorted = window.durations;
+        std::sort(sorted.begin(), sorted.end());
+
+        float sum = 0.0f;
+        for (int i = 0; i < sorted.size(); i++)
+            sum += sorted[i];
+
+        Summary summary;
+        summary.stage = it->first;
+        summary.count = window.count;
+        summary.last_ms = window.last_ms;
+        summary.mean_ms = sum / sorted.size();
+        summary.p50_ms = percentile(sorted, 0.5f);
+        summary.p90_ms = percentile(sorted, 0.9f);
+        summary.p99_ms = percentile(sorted, 0.99f);
+        summary.points_in = window.points_in;
+        summary.points_out = window.points_out;
+        summaries.push_back(summary);
+    }
+
+    if (trace_.is_open())
+        trace_.flush();
+}
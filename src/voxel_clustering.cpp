@@ -0,0 +1,145 @@
+#include <point_cloud_proc/voxel_clustering.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const uint64_t INVALID_KEY = std::numeric_limits<uint64_t>::max();
+const int64_t KEY_OFFSET = 1 << 20;
+
+inline uint64_t voxelKey(int64_t i, int64_t j, int64_t k) {
+    return (static_cast<uint64_t>(i + KEY_OFFSET) & 0x1FFFFF) |
+           ((static_cast<uint64_t>(j + KEY_OFFSET) & 0x1FFFFF) << 21) |
+           ((static_cast<uint64_t>(k + KEY_OFFSET) & 0x1FFFFF) << 42);
+}
+
+inline void voxelCoords(uint64_t key, int64_t &i, int64_t &j, int64_t &k) {
+    i = static_cast<int64_t>(key & 0x1FFFFF) - KEY_OFFSET;
+    j = static_cast<int64_t>((key >> 21) & 0x1FFFFF) - KEY_OFFSET;
+    k = static_cast<int64_t>((key >> 42) & 0x1FFFFF) - KEY_OFFSET;
+}
+
+bool largerCluster(const pcl::PointIndices &a, const pcl::PointIndices &b) {
+    return a.indices.size() > b.indices.size();
+}
+
+}
+
+VoxelClustering::VoxelClustering() :
+        voxel_size_(0.03f), min_cluster_size_(1), max_cluster_size_(std::numeric_limits<int>::max()) {
+}
+
+int VoxelClustering::findRoot(int voxel) {
+    while (voxel_parents_[voxel] != voxel) {
+        voxel_parents_[voxel] = voxel_parents_[voxel_parents_[voxel]];
+        voxel = voxel_parents_[voxel];
+    }
+    return voxel;
+}
+
+void VoxelClustering::unite(int voxel1, int voxel2) {
+    int root1 = findRoot(voxel1);
+    int root2 = findRoot(voxel2);
+    if (root1 == root2)
+        return;
+
+    // Smaller index becomes the root so labels don't depend on the merge order
+    if (root1 < root2)
+        voxel_parents_[root2] = root1;
+    else
+        voxel_parents_[root1] = root2;
+}
+
+void VoxelClustering::extract(const CloudT &cloud, std::vector<pcl::PointIndices> &clusters) {
+
+    clusters.clear();
+
+    const int n = static_cast<int>(cloud.points.size());
+    const float inverse_voxel_size = 1.0f / voxel_size_;
+
+    // Voxel keys are independent per point
+    point_keys_.resize(n);
+#pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        const PointT &p = cloud.points[i];
+        if (!pcl::isFinite(p)) {
+            point_keys_[i] = INVALID_KEY;
+            continue;
+        }
+        point_keys_[i] = voxelKey(static_cast<int64_t>(std::floor(p.x * inverse_voxel_size)),
+                                  static_cast<int64_t>(std::floor(p.y * inverse_voxel_size)),
+                                  static_cast<int64_t>(std::floor(p.z * inverse_voxel_size)));
+    }
+
+    grid_.clear();
+    voxel_keys_.clear();
+    point_voxels_.resize(n);
+
+    for (int i = 0; i < n; i++) {
+        if (point_keys_[i] == INVALID_KEY) {
+            point_voxels_[i] = -1;
+            continue;
+        }
+
+        std::pair<std::unordered_map<uint64_t, int>::iterator, bool> it =
+                grid_.insert(std::make_pair(point_keys_[i], static_cast<int>(voxel_keys_.size())));
+        if (it.second)
+            voxel_keys_.push_back(point_keys_[i]);
+        point_voxels_[i] = it.first->second;
+    }
+
+    const int n_voxels = static_cast<int>(voxel_keys_.size());
+    voxel_parents_.resize(n_voxels);
+    for (int v = 0; v < n_voxels; v++) {
+        voxel_parents_[v] = v;
+    }
+
+    // Each pair of neighbours is visited once by looking at half of the 26-neighbourhood
+    for (int v = 0; v < n_voxels; v++) {
+        int64_t i, j, k;
+        voxelCoords(voxel_keys_[v], i, j, k);
+
+        for (int dk = 0; dk <= 1; dk++) {
+            for (int dj = -1; dj <= 1; dj++) {
+                for (int di = -1; di <= 1; di++) {
+                    if (dk == 0 && (dj < 0 || (dj == 0 && di <= 0)))
+                        continue;
+
+                    std::unordered_map<uint64_t, int>::const_iterator neighbor =
+                            grid_.find(voxelKey(i + di, j + dj, k + dk));
+                    if (neighbor != grid_.end())
+                        unite(v, neighbor->second);
+                }
+            }
+        }
+    }
+
+    // Give every root a cluster label and gather the points
+    voxel_labels_.assign(n_voxels, -1);
+    std::vector<pcl::PointIndices> components;
+    for (int i = 0; i < n; i++) {
+        if (point_voxels_[i] < 0)
+            continue;
+
+        int root = findRoot(point_voxels_[i]);
+        if (voxel_labels_[root] < 0) {
+            voxel_labels_[root] = static_cast<int>(components.size());
+            components.push_back(pcl::PointIndices());
+        }
+        components[voxel_labels_[root]].indices.push_back(i);
+    }
+
+    for (size_t c = 0; c < components.size(); c++) {
+        int size = static_cast<int>(components[c].indices.size());
+        if (size < min_cluster_size_ || size > max_cluster_size_)
+            continue;
+
+        clusters.push_back(pcl::PointIndices());
+        clusters.back().header = cloud.header;
+        clusters.back().indices.swap(components[c].indices);
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), largerCluster);
+}
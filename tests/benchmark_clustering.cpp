@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <pcl/io/pcd_io.h>
+#include <pcl/point_types.h>
+#include <pcl/search/kdtree.h>
+#include <pcl/segmentation/extract_clusters.h>
+#include <point_cloud_proc/voxel_clustering.h>
+
+typedef pcl::PointXYZRGB PointT;
+typedef pcl::PointCloud<PointT> CloudT;
+
+// Compares pcl::EuclideanClusterExtraction with VoxelClustering on recorded tabletop clouds
+// usage: benchmark_clustering [-t cluster_tol] [-n repetitions] tabletop.pcd [tabletop.pcd ...]
+int main(int argc, char **argv) {
+
+  float cluster_tol = 0.03;
+  int repetitions = 20, min_cluster_size = 50, max_cluster_size = 25000;
+  std::vector<std::string> files;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-t" && i + 1 < argc) {
+      cluster_tol = std::atof(argv[++i]);
+    } else if (arg == "-n" && i + 1 < argc) {
+      repetitions = std::atoi(argv[++i]);
+    } else {
+      files.push_back(arg);
+    }
+  }
+
+  if (files.empty()) {
+    std::cout << "usage: benchmark_clustering [-t cluster_tol] [-n repetitions] tabletop.pcd [...]" << std::endl;
+    return 1;
+  }
+
+  for (const std::string &file : files) {
+    CloudT::Ptr cloud(new CloudT);
+    if (pcl::io::loadPCDFile(file, *cloud) < 0) {
+      std::cout << "PCP: couldn't load " << file << std::endl;
+      continue;
+    }
+
+    std::vector<pcl::PointIndices> ec_clusters, voxel_clusters;
+    double ec_time = 0.0, voxel_time = 0.0;
+
+    for (int r = 0; r < repetitions; r++) {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+      pcl::search::KdTree<PointT>::Ptr tree(new pcl::search::KdTree<PointT>);
+      pcl::EuclideanClusterExtraction<PointT> ec;
+      ec.setClusterTolerance(cluster_tol);
+      ec.setMinClusterSize(min_cluster_size);
+      ec.setMaxClusterSize(max_cluster_size);
+      ec.setSearchMethod(tree);
+      ec.setInputCloud(cloud);
+      ec.extract(ec_clusters);
+
+      std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+
+      VoxelClustering vc;
+      vc.setVoxelSize(cluster_tol);
+      vc.setMinClusterSize(min_cluster_size);
+      vc.setMaxClusterSize(max_cluster_size);
+      vc.extract(*cloud, voxel_clusters);
+
+      std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+      ec_time += std::chrono::duration<double, std::milli>(middle - start).count();
+      voxel_time += std::chrono::duration<double, std::milli>(end - middle).count();
+    }
+
+    std::cout << file << " : " << cloud->points.size() << " points" << std::endl;
+    std::cout << "  euclidean : " << ec_clusters.size() << " clusters, "
+              << ec_time / repetitions << " ms" << std::endl;
+    std::cout << "  voxel     : " << voxel_clusters.size() << " clusters, "
+              << voxel_time / repetitions << " ms" << std::endl;
+
+    for (int c = 0; c < std::max(ec_clusters.size(), voxel_clusters.size()); c++) {
+      std::cout << "  cluster " << c << " size : "
+                << (c < ec_clusters.size() ? ec_clusters[c].indices.size() : 0) << " / "
+                << (c < voxel_clusters.size() ? voxel_clusters[c].indices.size() : 0) << std::endl;
+    }
+  }
+
+  return 0;
+}
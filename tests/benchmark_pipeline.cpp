@@ -0,0 +1,223 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include <ros/package.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <point_cloud_proc/point_cloud_proc_core.h>
+
+typedef pcl::PointXYZRGB PointT;
+typedef pcl::PointCloud<PointT> CloudT;
+
+// Resident memory of the process in MB
+double residentMemory() {
+  std::ifstream statm("/proc/self/statm");
+  long size = 0, resident = 0;
+  statm >> size >> resident;
+  return resident * sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+}
+
+// Times one call of the public API and tracks the resident memory after it,
+// the memory is read once the timer has stopped so it isn't part of the latency
+class CallTimer {
+public:
+  CallTimer(StageMetrics &metrics, const char *call, double &peak_memory) :
+          peak_memory_(peak_memory), timer_(new StageTimer(metrics, call)) {}
+
+  ~CallTimer() {
+    timer_.reset();
+    peak_memory_ = std::max(peak_memory_, residentMemory());
+  }
+
+  void setPointsOut(size_t points_out) { timer_->setPointsOut(points_out); }
+
+private:
+  double &peak_memory_;
+  std::unique_ptr<StageTimer> timer_;
+};
+
+void printSummaries(StageMetrics &metrics) {
+  std::vector<StageMetrics::Summary> summaries;
+  metrics.getSummaries(summaries);
+
+  std::cout << "  " << std::left << std::setw(18) << "stage" << std::right
+            << std::setw(7) << "count" << std::setw(10) << "mean ms" << std::setw(10) << "p50 ms"
+            << std::setw(10) << "p90 ms" << std::setw(10) << "p99 ms"
+            << std::setw(10) << "in" << std::setw(10) << "out" << std::endl;
+  for (int i = 0; i < summaries.size(); i++) {
+    const StageMetrics::Summary &s = summaries[i];
+    std::cout << "  " << std::left << std::setw(18) << s.stage << std::right << std::fixed << std::setprecision(2)
+              << std::setw(7) << s.count << std::setw(10) << s.mean_ms << std::setw(10) << s.p50_ms
+              << std::setw(10) << s.p90_ms << std::setw(10) << s.p99_ms
+              << std::setw(10) << s.points_in << std::setw(10) << s.points_out << std::endl;
+  }
+}
+
+// Feeds recorded clouds through the processing chain with a fixed sensor pose and
+// reports the latency of every call and of every stage inside of them. Passing
+// several configs compares their modes on the same frames.
+// usage: benchmark_pipeline [-c config.yaml ...] [-n repetitions] [--topic cloud_topic]
+//                           [--pose x y z roll pitch yaw] [--no-mesh] cloud.pcd|recording.bag [...]
+int main(int argc, char **argv) {
+
+  int repetitions = 10;
+  bool mesh = true;
+  std::string topic;
+  std::vector<std::string> configs, files;
+  Eigen::Affine3f sensor_pose = Eigen::Affine3f::Identity();
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-c" && i + 1 < argc) {
+      configs.push_back(argv[++i]);
+    } else if (arg == "-n" && i + 1 < argc) {
+      repetitions = std::atoi(argv[++i]);
+    } else if (arg == "--topic" && i + 1 < argc) {
+      topic = argv[++i];
+    } else if (arg == "--pose" && i + 6 < argc) {
+      double v[6];
+      for (int j = 0; j < 6; j++) {
+        v[j] = std::atof(argv[++i]);
+      }
+      sensor_pose = Eigen::Translation3f(v[0], v[1], v[2]) *
+                    Eigen::AngleAxisf(v[5], Eigen::Vector3f::UnitZ()) *
+                    Eigen::AngleAxisf(v[4], Eigen::Vector3f::UnitY()) *
+                    Eigen::AngleAxisf(v[3], Eigen::Vector3f::UnitX());
+    } else if (arg == "--no-mesh") {
+      mesh = false;
+    } else {
+      files.push_back(arg);
+    }
+  }
+
+  if (files.empty()) {
+    std::cout << "usage: benchmark_pipeline [-c config.yaml ...] [-n repetitions] [--topic cloud_topic]" << std::endl
+              << "                          [--pose x y z roll pitch yaw] [--no-mesh] cloud.pcd|recording.bag [...]"
+              << std::endl;
+    return 1;
+  }
+
+  if (configs.empty()) {
+    configs.push_back(ros::package::getPath("point_cloud_proc") + "/config/default.yaml");
+  }
+
+  // Load and convert all the frames up front so file access isn't measured
+  std::vector<CloudT::Ptr> frames;
+  for (const std::string &file : files) {
+    if (file.size() > 4 && file.substr(file.size() - 4) == ".bag") {
+      rosbag::Bag bag(file, rosbag::bagmode::Read);
+      rosbag::View view(bag);
+      for (rosbag::View::iterator it = view.begin(); it != view.end(); ++it) {
+        if (!topic.empty() && it->getTopic() != topic) {
+          continue;
+        }
+        sensor_msgs::PointCloud2::Ptr msg = it->instantiate<sensor_msgs::PointCloud2>();
+        if (msg) {
+          CloudT::Ptr cloud(new CloudT);
+          pcl::fromROSMsg(*msg, *cloud);
+          frames.push_back(cloud);
+        }
+      }
+    } else {
+      CloudT::Ptr cloud(new CloudT);
+      if (pcl::io::loadPCDFile(file, *cloud) < 0) {
+        std::cout << "PCP: couldn't load " << file << std::endl;
+        continue;
+      }
+      frames.push_back(cloud);
+    }
+  }
+
+  std::cout << "PCP: " << frames.size() << " frames loaded" << std::endl;
+  if (frames.empty()) {
+    return 1;
+  }
+
+  for (const std::string &config : configs) {
+    PointCloudProcCore pcp(config);
+    pcp.getMetrics().setEnabled(true);
+    pcp.getMetrics().setWindowSize(repetitions * frames.size());
+
+    StageMetrics calls;
+    calls.setEnabled(true);
+    calls.setWindowSize(repetitions * frames.size());
+
+    double start_memory = residentMemory(), peak_memory = start_memory;
+    size_t points = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (int r = 0; r < repetitions; r++) {
+      for (int f = 0; f < frames.size(); f++) {
+        // Every repetition is a new frame for the stage caches
+        {
+          CallTimer timer(calls, "setInputCloud", peak_memory);
+          pcp.setInputCloud(frames[f], sensor_pose.matrix());
+        }
+        points += frames[f]->points.size();
+
+        {
+          CallTimer timer(calls, "filterPointCloud", peak_memory);
+          if (pcp.filterPointCloud()) {
+            timer.setPointsOut(pcp.getFilteredCloud()->points.size());
+          }
+        }
+
+        point_cloud_proc::Plane plane;
+        {
+          CallTimer timer(calls, "segmentSinglePlane", peak_memory);
+          pcp.segmentSinglePlane(plane);
+          timer.setPointsOut(plane.size.data);
+        }
+
+        std::vector<point_cloud_proc::Plane> planes;
+        {
+          CallTimer timer(calls, "segmentMultiplePlane", peak_memory);
+          pcp.segmentMultiplePlane(planes);
+          timer.setPointsOut(planes.size());
+        }
+
+        {
+          CallTimer timer(calls, "extractTabletop", peak_memory);
+          pcp.extractTabletop();
+        }
+
+        std::vector<point_cloud_proc::Object> objects;
+        {
+          CallTimer timer(calls, "clusterObjects", peak_memory);
+          pcp.clusterObjects(objects);
+          timer.setPointsOut(objects.size());
+        }
+
+        if (mesh && !objects.empty()) {
+          pcl_msgs::PolygonMesh mesh_msg;
+          pcl::PolygonMesh pcl_mesh;
+          CallTimer timer(calls, "generateMesh", peak_memory);
+          pcp.generateMeshFromPointCloud(objects[0].cloud, mesh_msg, pcl_mesh);
+          timer.setPointsOut(pcl_mesh.polygons.size());
+        }
+      }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    int frame_count = repetitions * frames.size();
+
+    std::cout << std::endl << "config : " << config << std::endl;
+    std::cout << std::fixed << std::setprecision(2)
+              << "  " << frame_count / seconds << " frames/s, "
+              << points / seconds / 1e6 << " Mpoints/s, memory "
+              << start_memory << " MB at start, " << peak_memory << " MB peak" << std::endl;
+    std::cout << "calls (later calls reuse the stages computed for the frame):" << std::endl;
+    printSummaries(calls);
+    std::cout << "stages:" << std::endl;
+    printSummaries(pcp.getMetrics());
+  }
+
+  return 0;
+}